@@ -0,0 +1,497 @@
+#include "bitgrid.h"
+#include "golstate.h"
+#include "hashlife.h"
+#include "tileworld.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DEFAULT_WARMUP 3
+#define BENCH_DEFAULT_REPEATS 20
+#define BENCH_DEFAULT_THRESHOLD 10.0
+#define BENCH_SEED 0x9e3779b97f4a7c15ULL
+#define BENCH_LINE_SIZE 512
+
+// Every engine is driven through the same calls, cells are given as (x, y)
+// inside the GRID_WIDTH x GRID_WIDTH grid. Cell updates/s count the cells
+// of that grid, whatever area the engine actually visits.
+typedef struct {
+    const char *name;
+    void *(*alloc)();
+    void (*destroy)(void *engine);
+    void (*give_birth_cell)(void *engine, int x, int y);
+    void (*next_generation)(void *engine);
+    int64_t (*population)(void *engine);
+} BenchEngine;
+
+typedef struct {
+    const char *name;
+    void (*load)(const BenchEngine *bench_engine, void *engine);
+} BenchWorkload;
+
+typedef struct {
+    const char *engine, *workload;
+    int generations;
+    double median_ms, p95_ms, cell_updates_per_second;
+    int64_t final_population;
+} BenchResult;
+
+static void *bench_golstate_alloc() {
+    return golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+}
+
+static void bench_golstate_destroy(void *engine) {
+    GolState *gol_state = engine;
+    golstate_destroy(&gol_state);
+}
+
+static void bench_golstate_give_birth_cell(void *engine, int x, int y) {
+    golstate_arbitrary_give_birth_cell(engine, y * GRID_WIDTH + x);
+}
+
+static void bench_golstate_next_generation(void *engine) {
+    golstate_analyze_generation(engine);
+    golstate_next_generation(engine);
+}
+
+static int64_t bench_golstate_population(void *engine) {
+    return ((GolState *)engine)->population;
+}
+
+static int bench_bitgrid_threads = 1;
+
+// NULL as well when the workers of bench_bitgrid_threads cannot start
+static void *bench_bitgrid_alloc() {
+    BitGrid *bit_grid = bitgrid_alloc();
+    if (bit_grid && bench_bitgrid_threads > 1 &&
+        !bitgrid_set_threads(bit_grid, bench_bitgrid_threads))
+        bitgrid_destroy(&bit_grid);
+    return bit_grid;
+}
+
+static void bench_bitgrid_destroy(void *engine) {
+    BitGrid *bit_grid = engine;
+    bitgrid_destroy(&bit_grid);
+}
+
+static void bench_bitgrid_give_birth_cell(void *engine, int x, int y) {
+    bitgrid_arbitrary_give_birth_cell(engine, y * GRID_WIDTH + x);
+}
+
+static void bench_bitgrid_next_generation(void *engine) {
+    bitgrid_next_generation(engine);
+}
+
+static int64_t bench_bitgrid_population(void *engine) {
+    return ((BitGrid *)engine)->population;
+}
+
+static void *bench_tileworld_alloc() { return tileworld_alloc(); }
+
+static void bench_tileworld_destroy(void *engine) {
+    TileWorld *tile_world = engine;
+    tileworld_destroy(&tile_world);
+}
+
+static void bench_tileworld_give_birth_cell(void *engine, int x, int y) {
+    tileworld_arbitrary_give_birth_cell(engine, x, y);
+}
+
+static void bench_tileworld_next_generation(void *engine) {
+    tileworld_next_generation(engine);
+}
+
+static int64_t bench_tileworld_population(void *engine) {
+    return ((TileWorld *)engine)->population;
+}
+
+static void *bench_hashlife_alloc() { return hashlife_alloc(); }
+
+static void bench_hashlife_destroy(void *engine) {
+    HashLife *hash_life = engine;
+    hashlife_destroy(&hash_life);
+}
+
+static void bench_hashlife_give_birth_cell(void *engine, int x, int y) {
+    hashlife_arbitrary_give_birth_cell(engine, x, y);
+}
+
+static void bench_hashlife_next_generation(void *engine) {
+    hashlife_step(engine, 0);
+}
+
+static int64_t bench_hashlife_population(void *engine) {
+    return ((HashLife *)engine)->population;
+}
+
+static const BenchEngine bench_engines[] = {
+    {"golstate", bench_golstate_alloc, bench_golstate_destroy,
+     bench_golstate_give_birth_cell, bench_golstate_next_generation,
+     bench_golstate_population},
+    {"bitgrid", bench_bitgrid_alloc, bench_bitgrid_destroy,
+     bench_bitgrid_give_birth_cell, bench_bitgrid_next_generation,
+     bench_bitgrid_population},
+    {"tileworld", bench_tileworld_alloc, bench_tileworld_destroy,
+     bench_tileworld_give_birth_cell, bench_tileworld_next_generation,
+     bench_tileworld_population},
+    {"hashlife", bench_hashlife_alloc, bench_hashlife_destroy,
+     bench_hashlife_give_birth_cell, bench_hashlife_next_generation,
+     bench_hashlife_population},
+};
+#define BENCH_ENGINES (int)(sizeof(bench_engines) / sizeof(*bench_engines))
+
+// xorshift64*, the same soups on every run and every platform
+static uint64_t bench_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+static void bench_load_soup(const BenchEngine *bench_engine, void *engine,
+                            int percent) {
+    uint64_t state = BENCH_SEED;
+    for (int y = 0; y < GRID_WIDTH; y++) {
+        for (int x = 0; x < GRID_WIDTH; x++) {
+            if (bench_random(&state) % 100 < (uint64_t)percent)
+                bench_engine->give_birth_cell(engine, x, y);
+        }
+    }
+}
+
+// Plaintext rows, 'O' is a live cell
+static void bench_load_rows(const BenchEngine *bench_engine, void *engine,
+                            const char **rows, int x, int y) {
+    for (int row = 0; rows[row]; row++) {
+        for (int column = 0; rows[row][column]; column++) {
+            if (rows[row][column] == 'O')
+                bench_engine->give_birth_cell(engine, x + column, y + row);
+        }
+    }
+}
+
+static void bench_load_soup_10(const BenchEngine *bench_engine, void *engine) {
+    bench_load_soup(bench_engine, engine, 10);
+}
+
+static void bench_load_soup_30(const BenchEngine *bench_engine, void *engine) {
+    bench_load_soup(bench_engine, engine, 30);
+}
+
+static void bench_load_soup_50(const BenchEngine *bench_engine, void *engine) {
+    bench_load_soup(bench_engine, engine, 50);
+}
+
+static const char *bench_glider[] = {".O.", "..O", "OOO", NULL};
+
+static void bench_load_glider_field(const BenchEngine *bench_engine,
+                                    void *engine) {
+    for (int y = 10; y < GRID_WIDTH - 10; y += 50) {
+        for (int x = 10; x < GRID_WIDTH - 10; x += 50) {
+            bench_load_rows(bench_engine, engine, bench_glider, x, y);
+        }
+    }
+}
+
+static void bench_load_r_pentomino(const BenchEngine *bench_engine,
+                                   void *engine) {
+    const char *rows[] = {".OO", "OO.", ".O.", NULL};
+    bench_load_rows(bench_engine, engine, rows, GRID_WIDTH / 2,
+                    GRID_WIDTH / 2);
+}
+
+static void bench_load_acorn(const BenchEngine *bench_engine, void *engine) {
+    const char *rows[] = {".O.....", "...O...", "OO..OOO", NULL};
+    bench_load_rows(bench_engine, engine, rows, GRID_WIDTH / 2,
+                    GRID_WIDTH / 2);
+}
+
+static void bench_load_gosper_gun(const BenchEngine *bench_engine,
+                                  void *engine) {
+    const char *rows[] = {
+        "........................O...........",
+        "......................O.O...........",
+        "............OO......OO............OO",
+        "...........O...O....OO............OO",
+        "OO........O.....O...OO..............",
+        "OO........O...O.OO....O.O...........",
+        "..........O.....O.......O...........",
+        "...........O...O....................",
+        "............OO......................",
+        NULL};
+    bench_load_rows(bench_engine, engine, rows, GRID_WIDTH / 4,
+                    GRID_WIDTH / 4);
+}
+
+static void bench_load_still_life_field(const BenchEngine *bench_engine,
+                                        void *engine) {
+    const char *block[] = {"OO", "OO", NULL};
+    for (int y = 1; y < GRID_WIDTH - 2; y += 5) {
+        for (int x = 1; x < GRID_WIDTH - 2; x += 5) {
+            bench_load_rows(bench_engine, engine, block, x, y);
+        }
+    }
+}
+
+static const BenchWorkload bench_workloads[] = {
+    {"soup_10", bench_load_soup_10},
+    {"soup_30", bench_load_soup_30},
+    {"soup_50", bench_load_soup_50},
+    {"glider_field", bench_load_glider_field},
+    {"r_pentomino", bench_load_r_pentomino},
+    {"acorn", bench_load_acorn},
+    {"gosper_gun", bench_load_gosper_gun},
+    {"still_life_field", bench_load_still_life_field},
+};
+#define BENCH_WORKLOADS                                                        \
+    (int)(sizeof(bench_workloads) / sizeof(*bench_workloads))
+
+static double bench_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int bench_compare_doubles(const void *a, const void *b) {
+    double value_a = *(const double *)a, value_b = *(const double *)b;
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+// False when the engine or the timings could not be allocated
+static bool bench_run(const BenchEngine *bench_engine,
+                      const BenchWorkload *workload, int warmup, int repeats,
+                      BenchResult *result) {
+    void *engine = bench_engine->alloc();
+    double *times = malloc(repeats * sizeof(*times));
+    if (!engine || !times) {
+        free(times);
+        if (engine)
+            bench_engine->destroy(engine);
+        return false;
+    }
+    workload->load(bench_engine, engine);
+    for (int i = 0; i < warmup; i++) {
+        bench_engine->next_generation(engine);
+    }
+
+    double total = 0;
+    for (int i = 0; i < repeats; i++) {
+        double start = bench_seconds();
+        bench_engine->next_generation(engine);
+        times[i] = bench_seconds() - start;
+        total += times[i];
+    }
+    qsort(times, repeats, sizeof(*times), bench_compare_doubles);
+
+    result->engine = bench_engine->name;
+    result->workload = workload->name;
+    result->generations = repeats;
+    result->median_ms = times[repeats / 2] * 1e3;
+    result->p95_ms = times[(repeats * 95 - 1) / 100] * 1e3;
+    result->cell_updates_per_second =
+        total > 0 ? (double)GRID_SIZE * repeats / total : 0;
+    result->final_population = bench_engine->population(engine);
+
+    free(times);
+    bench_engine->destroy(engine);
+    return true;
+}
+
+static bool bench_selected(const char *filter, const char *name) {
+    return !filter || strcmp(filter, name) == 0;
+}
+
+static void bench_write_json(FILE *file, BenchResult *results, int count,
+                             int warmup) {
+    fprintf(file,
+            "{\n  \"grid_width\": %d,\n  \"warmup\": %d,\n"
+            "  \"bitgrid_threads\": %d,\n",
+            GRID_WIDTH, warmup, bench_bitgrid_threads);
+    fprintf(file, "  \"results\": [\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(file,
+                "    {\"engine\": \"%s\", \"workload\": \"%s\", "
+                "\"generations\": %d, \"median_ms\": %.6f, "
+                "\"p95_ms\": %.6f, \"cell_updates_per_second\": %.6e, "
+                "\"final_population\": %lld}%s\n",
+                results[i].engine, results[i].workload,
+                results[i].generations, results[i].median_ms,
+                results[i].p95_ms, results[i].cell_updates_per_second,
+                (long long)results[i].final_population,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+// Reads the median of engine/workload from a file written by
+// bench_write_json(), one result per line
+static bool bench_baseline_median(const char *path, const char *engine,
+                                  const char *workload, double *median_ms) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    char engine_field[64], workload_field[64];
+    snprintf(engine_field, sizeof(engine_field), "\"engine\": \"%s\"",
+             engine);
+    snprintf(workload_field, sizeof(workload_field), "\"workload\": \"%s\"",
+             workload);
+
+    char line[BENCH_LINE_SIZE];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), file)) {
+        char *median = strstr(line, "\"median_ms\": ");
+        if (strstr(line, engine_field) && strstr(line, workload_field) &&
+            median) {
+            found = sscanf(median, "\"median_ms\": %lf", median_ms) == 1;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+static void bench_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-e engine] [-l workload] [-w warmup] [-n repeats] "
+            "[-p threads] [-o results.json] [-c baseline.json "
+            "[-t percent]]\n"
+            "  -e  only run this engine (golstate, bitgrid, tileworld, "
+            "hashlife)\n"
+            "  -l  only run this workload\n"
+            "  -w  generations stepped before timing (default %d)\n"
+            "  -n  timed generations (default %d)\n"
+            "  -p  BitGrid threads, up to the grid width (default 1)\n"
+            "  -o  write the results as JSON, \"-\" for stdout\n"
+            "  -c  compare medians against a previous JSON file\n"
+            "  -t  slowdown in percent reported as a regression "
+            "(default %.0f)\n",
+            program, BENCH_DEFAULT_WARMUP, BENCH_DEFAULT_REPEATS,
+            BENCH_DEFAULT_THRESHOLD);
+}
+
+int main(int argc, char **argv) {
+    const char *engine_filter = NULL, *workload_filter = NULL;
+    const char *output_path = NULL, *baseline_path = NULL;
+    int warmup = BENCH_DEFAULT_WARMUP, repeats = BENCH_DEFAULT_REPEATS;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+
+    int option;
+    while ((option = getopt(argc, argv, "e:l:w:n:p:o:c:t:h")) != -1) {
+        switch (option) {
+        case 'e':
+            engine_filter = optarg;
+            break;
+        case 'l':
+            workload_filter = optarg;
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            break;
+        case 'n':
+            repeats = atoi(optarg);
+            break;
+        case 'p':
+            bench_bitgrid_threads = atoi(optarg);
+            break;
+        case 'o':
+            output_path = optarg;
+            break;
+        case 'c':
+            baseline_path = optarg;
+            break;
+        case 't':
+            threshold = strtod(optarg, NULL);
+            break;
+        default:
+            bench_usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+    bool engine_found = false, workload_found = false;
+    for (int e = 0; e < BENCH_ENGINES; e++) {
+        engine_found |= bench_selected(engine_filter, bench_engines[e].name);
+    }
+    for (int w = 0; w < BENCH_WORKLOADS; w++) {
+        workload_found |=
+            bench_selected(workload_filter, bench_workloads[w].name);
+    }
+    if (warmup < 0 || repeats < 1 || bench_bitgrid_threads < 1 ||
+        bench_bitgrid_threads > GRID_WIDTH || optind < argc ||
+        !engine_found || !workload_found) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+    // BitGrid would otherwise run with fewer threads than the results claim
+    if (bench_bitgrid_threads > 1 && bench_selected(engine_filter, "bitgrid")) {
+        BitGrid *bit_grid = bench_bitgrid_alloc();
+        if (!bit_grid) {
+            fprintf(stderr, "Error: Could not start %d BitGrid threads\n",
+                    bench_bitgrid_threads);
+            bench_usage(argv[0]);
+            return 1;
+        }
+        bitgrid_destroy(&bit_grid);
+    }
+
+    BenchResult results[BENCH_ENGINES * BENCH_WORKLOADS];
+    int count = 0, regressions = 0;
+    fprintf(stderr, "%-10s %-17s %12s %12s %14s %10s\n", "engine",
+            "workload", "median ms", "p95 ms", "cell upd/s", "baseline");
+    for (int e = 0; e < BENCH_ENGINES; e++) {
+        const BenchEngine *bench_engine = &bench_engines[e];
+        if (!bench_selected(engine_filter, bench_engine->name))
+            continue;
+        for (int w = 0; w < BENCH_WORKLOADS; w++) {
+            const BenchWorkload *workload = &bench_workloads[w];
+            if (!bench_selected(workload_filter, workload->name))
+                continue;
+
+            BenchResult result;
+            if (!bench_run(bench_engine, workload, warmup, repeats,
+                           &result)) {
+                fprintf(stderr, "Error: Out of memory running %s on %s\n",
+                        bench_engine->name, workload->name);
+                return 1;
+            }
+            results[count++] = result;
+
+            char comparison[32] = "-";
+            double baseline_ms;
+            if (baseline_path &&
+                bench_baseline_median(baseline_path, result.engine,
+                                      result.workload, &baseline_ms) &&
+                baseline_ms > 0) {
+                double change = (result.median_ms / baseline_ms - 1) * 100;
+                bool regression = change > threshold;
+                regressions += regression;
+                snprintf(comparison, sizeof(comparison), "%+.1f%%%s", change,
+                         regression ? " SLOWER" : "");
+            }
+            fprintf(stderr, "%-10s %-17s %12.3f %12.3f %14.3e %10s\n",
+                    result.engine, result.workload, result.median_ms,
+                    result.p95_ms, result.cell_updates_per_second,
+                    comparison);
+        }
+    }
+
+    if (output_path) {
+        FILE *file = strcmp(output_path, "-") == 0 ? stdout
+                                                   : fopen(output_path, "w");
+        if (!file) {
+            fprintf(stderr, "Error: Could not write \"%s\"\n", output_path);
+            return 1;
+        }
+        bench_write_json(file, results, count, warmup);
+        if (file != stdout)
+            fclose(file);
+    }
+    if (regressions) {
+        fprintf(stderr, "%d regressions over %.0f%%\n", regressions,
+                threshold);
+        return 2;
+    }
+    return 0;
+}
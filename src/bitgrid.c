@@ -0,0 +1,479 @@
+#include "bitgrid.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITGRID_X86_KERNELS
+#endif
+
+static const uint64_t bitgrid_empty_row[BITGRID_ROW_WORDS];
+
+static void bitgrid_stop_workers(BitGrid *bit_grid);
+
+BitGrid *bitgrid_alloc() {
+    BitGrid *bit_grid = malloc(sizeof(*bit_grid));
+    if (!bit_grid)
+        return NULL;
+    bit_grid->thread_count = 1;
+    bit_grid->workers = NULL;
+    bit_grid->cells = calloc(BITGRID_WORDS, sizeof(*bit_grid->cells));
+    bit_grid->next_cells = calloc(BITGRID_WORDS, sizeof(*bit_grid->next_cells));
+    if (!bit_grid->cells || !bit_grid->next_cells) {
+        bitgrid_destroy(&bit_grid);
+        return NULL;
+    }
+    bit_grid->population = 0;
+    bit_grid->generation = 0;
+    return bit_grid;
+}
+
+void bitgrid_destroy(BitGrid **bit_grid) {
+    bitgrid_stop_workers(*bit_grid);
+    free((*bit_grid)->cells);
+    free((*bit_grid)->next_cells);
+    free(*bit_grid);
+    *bit_grid = NULL;
+}
+
+void bitgrid_restart(BitGrid *bit_grid) {
+    memset(bit_grid->cells, 0, BITGRID_WORDS * sizeof(*bit_grid->cells));
+    bit_grid->population = 0;
+    bit_grid->generation = 0;
+}
+
+static inline uint64_t *bitgrid_word_of(BitGrid *bit_grid, int grid_index) {
+    int line = grid_index / GRID_WIDTH;
+    int column = grid_index % GRID_WIDTH;
+    return &bit_grid->cells[line * BITGRID_ROW_WORDS +
+                            column / BITGRID_WORD_BITS];
+}
+
+static inline uint64_t bitgrid_bit_of(int grid_index) {
+    return (uint64_t)1 << ((grid_index % GRID_WIDTH) % BITGRID_WORD_BITS);
+}
+
+bool bitgrid_is_cell_alive(BitGrid *bit_grid, int grid_index) {
+    if (grid_index < 0 || grid_index >= GRID_SIZE)
+        return false;
+    return *bitgrid_word_of(bit_grid, grid_index) & bitgrid_bit_of(grid_index);
+}
+
+void bitgrid_arbitrary_give_birth_cell(BitGrid *bit_grid, int grid_index) {
+    if (grid_index < 0 || grid_index >= GRID_SIZE ||
+        bitgrid_is_cell_alive(bit_grid, grid_index))
+        return;
+    *bitgrid_word_of(bit_grid, grid_index) |= bitgrid_bit_of(grid_index);
+    bit_grid->population++;
+}
+
+void bitgrid_arbitrary_kill_cell(BitGrid *bit_grid, int grid_index) {
+    if (!bitgrid_is_cell_alive(bit_grid, grid_index))
+        return;
+    *bitgrid_word_of(bit_grid, grid_index) &= ~bitgrid_bit_of(grid_index);
+    bit_grid->population--;
+}
+
+static int bitgrid_next_row_scalar(const uint64_t *above,
+                                   const uint64_t *current,
+                                   const uint64_t *below, uint64_t *dst) {
+    int population = 0;
+    uint64_t previous_v0 = 0, previous_v1 = 0, previous_center = 0;
+    uint64_t v0 = above[0] ^ below[0];
+    uint64_t v1 = above[0] & below[0];
+    uint64_t center = current[0];
+    for (int w = 0; w < BITGRID_ROW_WORDS; w++) {
+        uint64_t next_v0 = 0, next_v1 = 0, next_center = 0;
+        if (w + 1 < BITGRID_ROW_WORDS) {
+            next_v0 = above[w + 1] ^ below[w + 1];
+            next_v1 = above[w + 1] & below[w + 1];
+            next_center = current[w + 1];
+        }
+
+        uint64_t word = bitgrid_next_word(
+            bitgrid_west(v0, previous_v0), v0, bitgrid_east(v0, next_v0),
+            bitgrid_west(v1, previous_v1), v1, bitgrid_east(v1, next_v1),
+            bitgrid_west(center, previous_center), center,
+            bitgrid_east(center, next_center));
+        if (w == BITGRID_ROW_WORDS - 1)
+            word &= BITGRID_LAST_WORD_MASK;
+        dst[w] = word;
+        population += __builtin_popcountll(word);
+
+        previous_v0 = v0;
+        previous_v1 = v1;
+        previous_center = center;
+        v0 = next_v0;
+        v1 = next_v1;
+        center = next_center;
+    }
+    return population;
+}
+
+#ifdef BITGRID_X86_KERNELS
+// Scalar step of the single word w, used by the vector kernels for the
+// words at both ends of a row
+static int bitgrid_next_row_word(const uint64_t *above,
+                                 const uint64_t *current,
+                                 const uint64_t *below, uint64_t *dst, int w) {
+    uint64_t previous_a = 0, previous_b = 0, previous_c = 0;
+    uint64_t next_a = 0, next_b = 0, next_c = 0;
+    if (w > 0) {
+        previous_a = above[w - 1];
+        previous_b = below[w - 1];
+        previous_c = current[w - 1];
+    }
+    if (w + 1 < BITGRID_ROW_WORDS) {
+        next_a = above[w + 1];
+        next_b = below[w + 1];
+        next_c = current[w + 1];
+    }
+    uint64_t v0 = above[w] ^ below[w], v1 = above[w] & below[w];
+    uint64_t word = bitgrid_next_word(
+        bitgrid_west(v0, previous_a ^ previous_b), v0,
+        bitgrid_east(v0, next_a ^ next_b),
+        bitgrid_west(v1, previous_a & previous_b), v1,
+        bitgrid_east(v1, next_a & next_b), bitgrid_west(current[w], previous_c),
+        current[w], bitgrid_east(current[w], next_c));
+    if (w == BITGRID_ROW_WORDS - 1)
+        word &= BITGRID_LAST_WORD_MASK;
+    dst[w] = word;
+    return __builtin_popcountll(word);
+}
+
+// Same adder network as bitgrid_next_word, 128 cells per iteration
+__attribute__((target("sse2"))) static int
+bitgrid_next_row_sse2(const uint64_t *above, const uint64_t *current,
+                      const uint64_t *below, uint64_t *dst) {
+#define LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define WEST(x, prev)                                                          \
+    _mm_or_si128(_mm_slli_epi64(x, 1), _mm_srli_epi64(prev, 63))
+#define EAST(x, next)                                                          \
+    _mm_or_si128(_mm_srli_epi64(x, 1), _mm_slli_epi64(next, 63))
+#define MAJ(a, b, c)                                                           \
+    _mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(c, _mm_xor_si128(a, b)))
+#define XOR3(a, b, c) _mm_xor_si128(_mm_xor_si128(a, b), c)
+    int population = bitgrid_next_row_word(above, current, below, dst, 0);
+    int w = 1;
+    for (; w + 2 < BITGRID_ROW_WORDS; w += 2) {
+        __m128i a_prev = LOAD(&above[w - 1]), a = LOAD(&above[w]),
+                a_next = LOAD(&above[w + 1]);
+        __m128i b_prev = LOAD(&below[w - 1]), b = LOAD(&below[w]),
+                b_next = LOAD(&below[w + 1]);
+        __m128i c_prev = LOAD(&current[w - 1]), c = LOAD(&current[w]),
+                c_next = LOAD(&current[w + 1]);
+
+        __m128i v0 = _mm_xor_si128(a, b), v1 = _mm_and_si128(a, b);
+        __m128i v0_west = WEST(v0, _mm_xor_si128(a_prev, b_prev));
+        __m128i v0_east = EAST(v0, _mm_xor_si128(a_next, b_next));
+        __m128i v1_west = WEST(v1, _mm_and_si128(a_prev, b_prev));
+        __m128i v1_east = EAST(v1, _mm_and_si128(a_next, b_next));
+        __m128i west = WEST(c, c_prev), east = EAST(c, c_next);
+
+        __m128i ones_a = XOR3(v0_west, v0, v0_east);
+        __m128i carry_a = MAJ(v0_west, v0, v0_east);
+        __m128i ones_b = _mm_xor_si128(west, east);
+        __m128i carry_b = _mm_and_si128(west, east);
+        __m128i ones = _mm_xor_si128(ones_a, ones_b);
+        __m128i carry_c = _mm_and_si128(ones_a, ones_b);
+        __m128i p0 = XOR3(v1_west, v1, v1_east);
+        __m128i p1 = MAJ(v1_west, v1, v1_east);
+        __m128i q0 = XOR3(carry_a, carry_b, carry_c);
+        __m128i q1 = MAJ(carry_a, carry_b, carry_c);
+        __m128i exactly_one_two =
+            _mm_andnot_si128(_mm_or_si128(p1, q1), _mm_xor_si128(p0, q0));
+        _mm_storeu_si128((__m128i *)&dst[w],
+                         _mm_and_si128(exactly_one_two, _mm_or_si128(ones, c)));
+        population +=
+            __builtin_popcountll(dst[w]) + __builtin_popcountll(dst[w + 1]);
+    }
+#undef LOAD
+#undef WEST
+#undef EAST
+#undef MAJ
+#undef XOR3
+    for (; w < BITGRID_ROW_WORDS; w++)
+        population += bitgrid_next_row_word(above, current, below, dst, w);
+    return population;
+}
+
+// Same adder network as bitgrid_next_word, 256 cells per iteration
+__attribute__((target("avx2"))) static int
+bitgrid_next_row_avx2(const uint64_t *above, const uint64_t *current,
+                      const uint64_t *below, uint64_t *dst) {
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define WEST(x, prev)                                                          \
+    _mm256_or_si256(_mm256_slli_epi64(x, 1), _mm256_srli_epi64(prev, 63))
+#define EAST(x, next)                                                          \
+    _mm256_or_si256(_mm256_srli_epi64(x, 1), _mm256_slli_epi64(next, 63))
+#define MAJ(a, b, c)                                                           \
+    _mm256_or_si256(_mm256_and_si256(a, b),                                    \
+                    _mm256_and_si256(c, _mm256_xor_si256(a, b)))
+#define XOR3(a, b, c) _mm256_xor_si256(_mm256_xor_si256(a, b), c)
+    int population = bitgrid_next_row_word(above, current, below, dst, 0);
+    int w = 1;
+    for (; w + 4 < BITGRID_ROW_WORDS; w += 4) {
+        __m256i a_prev = LOAD(&above[w - 1]), a = LOAD(&above[w]),
+                a_next = LOAD(&above[w + 1]);
+        __m256i b_prev = LOAD(&below[w - 1]), b = LOAD(&below[w]),
+                b_next = LOAD(&below[w + 1]);
+        __m256i c_prev = LOAD(&current[w - 1]), c = LOAD(&current[w]),
+                c_next = LOAD(&current[w + 1]);
+
+        __m256i v0 = _mm256_xor_si256(a, b), v1 = _mm256_and_si256(a, b);
+        __m256i v0_west = WEST(v0, _mm256_xor_si256(a_prev, b_prev));
+        __m256i v0_east = EAST(v0, _mm256_xor_si256(a_next, b_next));
+        __m256i v1_west = WEST(v1, _mm256_and_si256(a_prev, b_prev));
+        __m256i v1_east = EAST(v1, _mm256_and_si256(a_next, b_next));
+        __m256i west = WEST(c, c_prev), east = EAST(c, c_next);
+
+        __m256i ones_a = XOR3(v0_west, v0, v0_east);
+        __m256i carry_a = MAJ(v0_west, v0, v0_east);
+        __m256i ones_b = _mm256_xor_si256(west, east);
+        __m256i carry_b = _mm256_and_si256(west, east);
+        __m256i ones = _mm256_xor_si256(ones_a, ones_b);
+        __m256i carry_c = _mm256_and_si256(ones_a, ones_b);
+        __m256i p0 = XOR3(v1_west, v1, v1_east);
+        __m256i p1 = MAJ(v1_west, v1, v1_east);
+        __m256i q0 = XOR3(carry_a, carry_b, carry_c);
+        __m256i q1 = MAJ(carry_a, carry_b, carry_c);
+        __m256i exactly_one_two = _mm256_andnot_si256(_mm256_or_si256(p1, q1),
+                                                      _mm256_xor_si256(p0, q0));
+        _mm256_storeu_si256(
+            (__m256i *)&dst[w],
+            _mm256_and_si256(exactly_one_two, _mm256_or_si256(ones, c)));
+        population +=
+            __builtin_popcountll(dst[w]) + __builtin_popcountll(dst[w + 1]) +
+            __builtin_popcountll(dst[w + 2]) + __builtin_popcountll(dst[w + 3]);
+    }
+#undef LOAD
+#undef WEST
+#undef EAST
+#undef MAJ
+#undef XOR3
+    for (; w < BITGRID_ROW_WORDS; w++)
+        population += bitgrid_next_row_word(above, current, below, dst, w);
+    return population;
+}
+#endif // BITGRID_X86_KERNELS
+
+typedef int (*BitGridRowKernel)(const uint64_t *above, const uint64_t *current,
+                                const uint64_t *below, uint64_t *dst);
+
+static BitGridKernel bitgrid_kernel = BITGRID_KERNEL_SCALAR;
+static BitGridRowKernel bitgrid_next_row = bitgrid_next_row_scalar;
+
+bool bitgrid_kernel_is_supported(BitGridKernel kernel) {
+    switch (kernel) {
+    case BITGRID_KERNEL_SCALAR:
+        return true;
+#ifdef BITGRID_X86_KERNELS
+    case BITGRID_KERNEL_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case BITGRID_KERNEL_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+bool bitgrid_set_kernel(BitGridKernel kernel) {
+    if (!bitgrid_kernel_is_supported(kernel))
+        return false;
+    switch (kernel) {
+#ifdef BITGRID_X86_KERNELS
+    case BITGRID_KERNEL_SSE2:
+        bitgrid_next_row = bitgrid_next_row_sse2;
+        break;
+    case BITGRID_KERNEL_AVX2:
+        bitgrid_next_row = bitgrid_next_row_avx2;
+        break;
+#endif
+    default:
+        bitgrid_next_row = bitgrid_next_row_scalar;
+        break;
+    }
+    bitgrid_kernel = kernel;
+    return true;
+}
+
+BitGridKernel bitgrid_get_kernel() { return bitgrid_kernel; }
+
+const char *bitgrid_kernel_name(BitGridKernel kernel) {
+    switch (kernel) {
+    case BITGRID_KERNEL_SSE2:
+        return "sse2";
+    case BITGRID_KERNEL_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+// Pick the widest kernel the CPU supports before main() runs
+__attribute__((constructor)) static void bitgrid_select_kernel(void) {
+    if (!bitgrid_set_kernel(BITGRID_KERNEL_AVX2) &&
+        !bitgrid_set_kernel(BITGRID_KERNEL_SSE2))
+        bitgrid_set_kernel(BITGRID_KERNEL_SCALAR);
+}
+
+// Steps the lines [first_line, last_line) into next_cells. The lines just
+// outside of the stripe are only read, so stripes can run concurrently.
+static int bitgrid_next_stripe(BitGrid *bit_grid, int first_line,
+                               int last_line) {
+    int population = 0;
+    for (int line = first_line; line < last_line; line++) {
+        const uint64_t *current = &bit_grid->cells[line * BITGRID_ROW_WORDS];
+        const uint64_t *above =
+            line > 0 ? current - BITGRID_ROW_WORDS : bitgrid_empty_row;
+        const uint64_t *below = line < GRID_WIDTH - 1
+                                    ? current + BITGRID_ROW_WORDS
+                                    : bitgrid_empty_row;
+        population += bitgrid_next_row(
+            above, current, below,
+            &bit_grid->next_cells[line * BITGRID_ROW_WORDS]);
+    }
+    return population;
+}
+
+typedef struct {
+    BitGridWorkers *workers;
+    int stripe;
+} BitGridWorkerArgs;
+
+struct BitGridWorkers {
+    BitGrid *bit_grid;
+    int thread_count;
+    pthread_t *threads;
+    BitGridWorkerArgs *args;
+    int *stripe_populations;
+    pthread_mutex_t startup;
+    pthread_barrier_t generation_start, generation_done;
+    bool quit;
+};
+
+static void bitgrid_run_stripe(BitGridWorkers *workers, int stripe) {
+    int first_line = GRID_WIDTH * stripe / workers->thread_count;
+    int last_line = GRID_WIDTH * (stripe + 1) / workers->thread_count;
+    workers->stripe_populations[stripe] =
+        bitgrid_next_stripe(workers->bit_grid, first_line, last_line);
+}
+
+static void *bitgrid_worker(void *arg) {
+    BitGridWorkerArgs *args = arg;
+    BitGridWorkers *workers = args->workers;
+    // Barriers are initialized once every thread is created
+    pthread_mutex_lock(&workers->startup);
+    pthread_mutex_unlock(&workers->startup);
+    while (true) {
+        pthread_barrier_wait(&workers->generation_start);
+        if (workers->quit)
+            break;
+        bitgrid_run_stripe(workers, args->stripe);
+        pthread_barrier_wait(&workers->generation_done);
+    }
+    return NULL;
+}
+
+static void bitgrid_stop_workers(BitGrid *bit_grid) {
+    BitGridWorkers *workers = bit_grid->workers;
+    if (!workers)
+        return;
+    workers->quit = true;
+    pthread_barrier_wait(&workers->generation_start);
+    for (int i = 1; i < workers->thread_count; i++) {
+        pthread_join(workers->threads[i], NULL);
+    }
+    pthread_barrier_destroy(&workers->generation_start);
+    pthread_barrier_destroy(&workers->generation_done);
+    free(workers->threads);
+    free(workers->args);
+    free(workers->stripe_populations);
+    pthread_mutex_destroy(&workers->startup);
+    free(workers);
+    bit_grid->workers = NULL;
+    bit_grid->thread_count = 1;
+}
+
+// The calling thread steps the first stripe, so thread_count - 1 workers are
+// started and kept waiting on the generation_start barrier between calls
+static bool bitgrid_start_workers(BitGrid *bit_grid, int thread_count) {
+    BitGridWorkers *workers = calloc(1, sizeof(*workers));
+    if (!workers)
+        return false;
+    workers->bit_grid = bit_grid;
+    workers->thread_count = thread_count;
+    workers->threads = calloc(thread_count, sizeof(*workers->threads));
+    workers->args = calloc(thread_count, sizeof(*workers->args));
+    workers->stripe_populations =
+        calloc(thread_count, sizeof(*workers->stripe_populations));
+    if (!workers->threads || !workers->args || !workers->stripe_populations) {
+        free(workers->threads);
+        free(workers->args);
+        free(workers->stripe_populations);
+        free(workers);
+        return false;
+    }
+    pthread_mutex_init(&workers->startup, NULL);
+
+    pthread_mutex_lock(&workers->startup);
+    int started = 1;
+    for (; started < thread_count; started++) {
+        workers->args[started].workers = workers;
+        workers->args[started].stripe = started;
+        if (pthread_create(&workers->threads[started], NULL, bitgrid_worker,
+                           &workers->args[started]) != 0)
+            break;
+    }
+    workers->thread_count = started;
+    pthread_barrier_init(&workers->generation_start, NULL, started);
+    pthread_barrier_init(&workers->generation_done, NULL, started);
+    pthread_mutex_unlock(&workers->startup);
+
+    bit_grid->workers = workers;
+    bit_grid->thread_count = started;
+    if (started < thread_count) {
+        bitgrid_stop_workers(bit_grid);
+        return false;
+    }
+    return true;
+}
+
+bool bitgrid_set_threads(BitGrid *bit_grid, int thread_count) {
+    if (thread_count < 1)
+        thread_count = 1;
+    if (thread_count > GRID_WIDTH)
+        thread_count = GRID_WIDTH;
+    if (thread_count == bit_grid->thread_count)
+        return true;
+    bitgrid_stop_workers(bit_grid);
+    if (thread_count == 1)
+        return true;
+    return bitgrid_start_workers(bit_grid, thread_count);
+}
+
+void bitgrid_next_generation(BitGrid *bit_grid) {
+    int population = 0;
+    BitGridWorkers *workers = bit_grid->workers;
+    if (workers) {
+        pthread_barrier_wait(&workers->generation_start);
+        bitgrid_run_stripe(workers, 0);
+        pthread_barrier_wait(&workers->generation_done);
+        for (int i = 0; i < workers->thread_count; i++) {
+            population += workers->stripe_populations[i];
+        }
+    } else {
+        population = bitgrid_next_stripe(bit_grid, 0, GRID_WIDTH);
+    }
+
+    uint64_t *swap = bit_grid->cells;
+    bit_grid->cells = bit_grid->next_cells;
+    bit_grid->next_cells = swap;
+    bit_grid->population = population;
+    bit_grid->generation++;
+}
@@ -0,0 +1,86 @@
+#ifndef _BITGRID_H_
+#define _BITGRID_H_
+
+#include "golstate.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Each row of the grid is stored as 64 cells per word, the bit x % 64 of the
+// word x / 64 holds the cell of column x. Bits past GRID_WIDTH are always 0.
+#define BITGRID_WORD_BITS 64
+#define BITGRID_ROW_WORDS                                                      \
+    ((GRID_WIDTH + BITGRID_WORD_BITS - 1) / BITGRID_WORD_BITS)
+#define BITGRID_WORDS (BITGRID_ROW_WORDS * GRID_WIDTH)
+#define BITGRID_LAST_WORD_MASK                                                 \
+    (GRID_WIDTH % BITGRID_WORD_BITS == 0                                       \
+         ? ~(uint64_t)0                                                        \
+         : ((uint64_t)1 << (GRID_WIDTH % BITGRID_WORD_BITS)) - 1)
+
+// Row kernels, the widest one supported by the CPU is selected at startup
+typedef enum {
+    BITGRID_KERNEL_SCALAR,
+    BITGRID_KERNEL_SSE2,
+    BITGRID_KERNEL_AVX2
+} BitGridKernel;
+
+// Neighbors at column x - 1 and x + 1 moved into the bit of column x
+static inline uint64_t bitgrid_west(uint64_t word, uint64_t previous_word) {
+    return (word << 1) | (previous_word >> (BITGRID_WORD_BITS - 1));
+}
+
+static inline uint64_t bitgrid_east(uint64_t word, uint64_t next_word) {
+    return (word >> 1) | (next_word << (BITGRID_WORD_BITS - 1));
+}
+
+// The rows above and below are added together first (v1:v0 holds 0..2 per
+// column), then the three columns of that sum and the west and east cells of
+// the current row are reduced with full adders. A cell is alive in the next
+// generation when the count is 3, or when it is 2 and the cell is alive.
+static inline uint64_t bitgrid_next_word(uint64_t v0_west, uint64_t v0,
+                                         uint64_t v0_east, uint64_t v1_west,
+                                         uint64_t v1, uint64_t v1_east,
+                                         uint64_t west, uint64_t center,
+                                         uint64_t east) {
+    uint64_t ones_a = v0_west ^ v0 ^ v0_east;
+    uint64_t carry_a = (v0_west & v0) | (v0_east & (v0_west ^ v0));
+    uint64_t ones_b = west ^ east;
+    uint64_t carry_b = west & east;
+    uint64_t ones = ones_a ^ ones_b;
+    uint64_t carry_c = ones_a & ones_b;
+
+    // Exactly one of the six weight-two terms must be set for a count of 2-3
+    uint64_t p0 = v1_west ^ v1 ^ v1_east;
+    uint64_t p1 = (v1_west & v1) | (v1_east & (v1_west ^ v1));
+    uint64_t q0 = carry_a ^ carry_b ^ carry_c;
+    uint64_t q1 = (carry_a & carry_b) | (carry_c & (carry_a ^ carry_b));
+    uint64_t exactly_one_two = (p0 ^ q0) & ~(p1 | q1);
+
+    return exactly_one_two & (ones | center);
+}
+
+typedef struct BitGridWorkers BitGridWorkers;
+
+typedef struct {
+    uint64_t *cells;
+    uint64_t *next_cells;
+    int population, generation;
+    // Generations are stepped in thread_count horizontal stripes
+    int thread_count;
+    BitGridWorkers *workers;
+} BitGrid;
+
+BitGrid *bitgrid_alloc();
+void bitgrid_destroy(BitGrid **bit_grid);
+void bitgrid_restart(BitGrid *bit_grid);
+bool bitgrid_is_cell_alive(BitGrid *bit_grid, int grid_index);
+void bitgrid_arbitrary_give_birth_cell(BitGrid *bit_grid, int grid_index);
+void bitgrid_arbitrary_kill_cell(BitGrid *bit_grid, int grid_index);
+void bitgrid_next_generation(BitGrid *bit_grid);
+bool bitgrid_set_threads(BitGrid *bit_grid, int thread_count);
+bool bitgrid_kernel_is_supported(BitGridKernel kernel);
+bool bitgrid_set_kernel(BitGridKernel kernel);
+BitGridKernel bitgrid_get_kernel();
+const char *bitgrid_kernel_name(BitGridKernel kernel);
+
+#endif // _BITGRID_H_
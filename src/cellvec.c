@@ -0,0 +1,86 @@
+#include "cellvec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+CellVec *cellvec_alloc() {
+    CellVec *cell_vec = malloc(sizeof(*cell_vec));
+    if (!cell_vec)
+        return NULL;
+    cell_vec->data = NULL;
+    cell_vec->len = 0;
+    cell_vec->capacity = 0;
+    return cell_vec;
+}
+
+void cellvec_destroy(CellVec **cell_vec) {
+    if (!*cell_vec)
+        return;
+    free((*cell_vec)->data);
+    free(*cell_vec);
+    *cell_vec = NULL;
+}
+
+// Lengths are kept in an int, a vector never holds more than INT32_MAX cells
+static void cellvec_check_room(CellVec *cell_vec, int count) {
+    if (count > INT32_MAX - cell_vec->len) {
+        fprintf(stderr, "Error: CellVec cannot hold more than %d cells\n",
+                INT32_MAX);
+        exit(1);
+    }
+}
+
+void cellvec_reserve(CellVec *cell_vec, int capacity) {
+    if (capacity <= cell_vec->capacity)
+        return;
+    size_t new_capacity = cell_vec->capacity ? cell_vec->capacity
+                                             : CELLVEC_INITIAL_CAPACITY;
+    while (new_capacity < (size_t)capacity) {
+        new_capacity *= 2;
+    }
+    if (new_capacity > INT32_MAX)
+        new_capacity = INT32_MAX;
+    int32_t *data = realloc(cell_vec->data, new_capacity * sizeof(*data));
+    if (!data) {
+        fprintf(stderr, "Error: CellVec out of memory\n");
+        exit(1);
+    }
+    cell_vec->data = data;
+    cell_vec->capacity = new_capacity;
+}
+
+void cellvec_push(CellVec *cell_vec, int32_t cell) {
+    if (cell_vec->len == cell_vec->capacity) {
+        cellvec_check_room(cell_vec, 1);
+        cellvec_reserve(cell_vec, cell_vec->len + 1);
+    }
+    cell_vec->data[cell_vec->len++] = cell;
+}
+
+void cellvec_append(CellVec *cell_vec, CellVec *other) {
+    if (!other->len)
+        return;
+    cellvec_check_room(cell_vec, other->len);
+    cellvec_reserve(cell_vec, cell_vec->len + other->len);
+    memcpy(cell_vec->data + cell_vec->len, other->data,
+           other->len * sizeof(*other->data));
+    cell_vec->len += other->len;
+}
+
+int cellvec_find(CellVec *cell_vec, int32_t cell) {
+    for (int i = 0; i < cell_vec->len; i++) {
+        if (cell_vec->data[i] == cell)
+            return i;
+    }
+    return -1;
+}
+
+// Order is not kept, the last cell takes the place of the removed one
+void cellvec_swap_remove(CellVec *cell_vec, int index) {
+    if (index < 0 || index >= cell_vec->len)
+        return;
+    cell_vec->data[index] = cell_vec->data[--cell_vec->len];
+}
+
+void cellvec_clear(CellVec *cell_vec) { cell_vec->len = 0; }
@@ -0,0 +1,24 @@
+#ifndef _CELLVEC_H_
+#define _CELLVEC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CELLVEC_INITIAL_CAPACITY 64
+
+// Growable array of grid indexes, clearing keeps the storage for reuse
+typedef struct {
+    int32_t *data;
+    int len, capacity;
+} CellVec;
+
+CellVec *cellvec_alloc();
+void cellvec_destroy(CellVec **cell_vec);
+void cellvec_reserve(CellVec *cell_vec, int capacity);
+void cellvec_push(CellVec *cell_vec, int32_t cell);
+void cellvec_append(CellVec *cell_vec, CellVec *other);
+int cellvec_find(CellVec *cell_vec, int32_t cell);
+void cellvec_swap_remove(CellVec *cell_vec, int index);
+void cellvec_clear(CellVec *cell_vec);
+
+#endif // _CELLVEC_H_
@@ -0,0 +1,243 @@
+#include "checkpoint.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECKPOINT_BITMAP_SIZE (BITGRID_WORDS * sizeof(uint64_t))
+#define CHECKPOINT_SIZE (sizeof(CheckpointHeader) + CHECKPOINT_BITMAP_SIZE)
+#define CHECKPOINT_BATCH_CELLS 4096
+
+// FNV-1a over 64 bit words
+static uint64_t checkpoint_checksum(const void *data, size_t size) {
+    const uint64_t *words = data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size / sizeof(*words); i++) {
+        hash ^= words[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t checkpoint_header_checksum(const CheckpointHeader *header) {
+    return checkpoint_checksum(header,
+                               offsetof(CheckpointHeader, header_checksum));
+}
+
+static void checkpoint_fill_header(CheckpointHeader *header,
+                                   LifeRule rule, GolStateTopology topology,
+                                   uint64_t generation,
+                                   uint64_t population,
+                                   const uint64_t *bitmap) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+    header->version = CHECKPOINT_VERSION;
+    header->grid_width = GRID_WIDTH;
+    header->row_words = BITGRID_ROW_WORDS;
+    header->rule_transitions = rule.transitions;
+    header->topology = topology;
+    header->generation = generation;
+    header->population = population;
+    header->bitmap_checksum =
+        checkpoint_checksum(bitmap, CHECKPOINT_BITMAP_SIZE);
+    header->header_checksum = checkpoint_header_checksum(header);
+}
+
+// The whole file is written with one sequential write to a temporary file
+// that replaces path, an interrupted save leaves the previous checkpoint
+static bool checkpoint_write(const char *path, const void *data,
+                             size_t size) {
+    size_t path_len = strlen(path);
+    char *tmp_path = malloc(path_len + sizeof(".tmp"));
+    if (!tmp_path)
+        return false;
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", sizeof(".tmp"));
+
+    bool ok = false;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        const char *bytes = data;
+        size_t written = 0;
+        while (written < size) {
+            ssize_t result = write(fd, bytes + written, size - written);
+            if (result <= 0)
+                break;
+            written += result;
+        }
+        ok = written == size;
+        ok = close(fd) == 0 && ok;
+        ok = ok && rename(tmp_path, path) == 0;
+        if (!ok)
+            unlink(tmp_path);
+    }
+    free(tmp_path);
+    return ok;
+}
+
+bool checkpoint_map(const char *path, CheckpointMapping *mapping) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 ||
+        (size_t)file_stat.st_size != CHECKPOINT_SIZE) {
+        close(fd);
+        return false;
+    }
+    void *address = mmap(NULL, CHECKPOINT_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return false;
+
+    const CheckpointHeader *header = address;
+    const uint64_t *bitmap = (const uint64_t *)(header + 1);
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE) != 0 ||
+        header->version != CHECKPOINT_VERSION ||
+        header->header_checksum != checkpoint_header_checksum(header) ||
+        header->grid_width != GRID_WIDTH ||
+        header->row_words != BITGRID_ROW_WORDS ||
+        header->topology > GOLSTATE_TOPOLOGY_TORUS ||
+        header->bitmap_checksum !=
+            checkpoint_checksum(bitmap, CHECKPOINT_BITMAP_SIZE)) {
+        munmap(address, CHECKPOINT_SIZE);
+        return false;
+    }
+
+    mapping->address = address;
+    mapping->size = CHECKPOINT_SIZE;
+    mapping->header = header;
+    mapping->bitmap = bitmap;
+    return true;
+}
+
+void checkpoint_unmap(CheckpointMapping *mapping) {
+    if (!mapping->address)
+        return;
+    munmap(mapping->address, mapping->size);
+    mapping->address = NULL;
+    mapping->header = NULL;
+    mapping->bitmap = NULL;
+}
+
+static bool checkpoint_fits_golstate(GolState *gol_state) {
+    return gol_state->width == GRID_WIDTH && gol_state->height == GRID_WIDTH;
+}
+
+bool checkpoint_save_golstate(GolState *gol_state, const char *path) {
+    if (!checkpoint_fits_golstate(gol_state))
+        return false;
+    char *data = calloc(1, CHECKPOINT_SIZE);
+    if (!data)
+        return false;
+    CheckpointHeader *header = (CheckpointHeader *)data;
+    uint64_t *bitmap = (uint64_t *)(header + 1);
+    CellVec *alive_cells = gol_state->alive_cells;
+    for (int i = 0; i < alive_cells->len; i++) {
+        int x = golstate_cell_x(gol_state, alive_cells->data[i]);
+        int y = golstate_cell_y(gol_state, alive_cells->data[i]);
+        bitmap[y * BITGRID_ROW_WORDS + x / BITGRID_WORD_BITS] |=
+            (uint64_t)1 << (x % BITGRID_WORD_BITS);
+    }
+    checkpoint_fill_header(header, gol_state->rule, gol_state->topology,
+                           gol_state->generation, gol_state->population,
+                           bitmap);
+
+    bool ok = checkpoint_write(path, data, CHECKPOINT_SIZE);
+    free(data);
+    return ok;
+}
+
+// Bits past the grid width would land on the next row, and the cells have to
+// add up to the stored population
+static bool checkpoint_bitmap_is_valid(const CheckpointMapping *mapping) {
+    uint64_t population = 0;
+    for (int y = 0; y < GRID_WIDTH; y++) {
+        for (int w = 0; w < BITGRID_ROW_WORDS; w++) {
+            uint64_t word = mapping->bitmap[y * BITGRID_ROW_WORDS + w];
+            int columns = GRID_WIDTH - w * BITGRID_WORD_BITS;
+            if (columns < BITGRID_WORD_BITS && word >> columns)
+                return false;
+            population += __builtin_popcountll(word);
+        }
+    }
+    return population == mapping->header->population;
+}
+
+// Live cells are read off the mapped bitmap a word at a time. gol_state is
+// left untouched when the checkpoint is rejected.
+bool checkpoint_load_golstate(GolState *gol_state, const char *path) {
+    CheckpointMapping mapping;
+    if (!checkpoint_fits_golstate(gol_state) ||
+        !checkpoint_map(path, &mapping))
+        return false;
+    if (mapping.header->generation > INT_MAX ||
+        !checkpoint_bitmap_is_valid(&mapping)) {
+        checkpoint_unmap(&mapping);
+        return false;
+    }
+
+    golstate_restart(gol_state);
+    golstate_set_topology(gol_state, mapping.header->topology);
+    int batch[CHECKPOINT_BATCH_CELLS];
+    int batch_len = 0;
+    for (int y = 0; y < GRID_WIDTH; y++) {
+        for (int w = 0; w < BITGRID_ROW_WORDS; w++) {
+            uint64_t word = mapping.bitmap[y * BITGRID_ROW_WORDS + w];
+            while (word) {
+                int x = w * BITGRID_WORD_BITS + __builtin_ctzll(word);
+                word &= word - 1;
+                batch[batch_len++] = y * GRID_WIDTH + x;
+                if (batch_len == CHECKPOINT_BATCH_CELLS) {
+                    golstate_give_birth_cells(gol_state, batch, batch_len);
+                    batch_len = 0;
+                }
+            }
+        }
+    }
+    golstate_give_birth_cells(gol_state, batch, batch_len);
+    gol_state->generation = mapping.header->generation;
+    LifeRule rule = {mapping.header->rule_transitions};
+    golstate_set_rule(gol_state, rule);
+    checkpoint_unmap(&mapping);
+    return true;
+}
+
+bool checkpoint_save_bitgrid(BitGrid *bit_grid, const char *path) {
+    char *data = malloc(CHECKPOINT_SIZE);
+    if (!data)
+        return false;
+    CheckpointHeader *header = (CheckpointHeader *)data;
+    memcpy(header + 1, bit_grid->cells, CHECKPOINT_BITMAP_SIZE);
+    checkpoint_fill_header(header, liferule_conway(), GOLSTATE_TOPOLOGY_BOUNDED,
+                           bit_grid->generation, bit_grid->population,
+                           bit_grid->cells);
+
+    bool ok = checkpoint_write(path, data, CHECKPOINT_SIZE);
+    free(data);
+    return ok;
+}
+
+// The bitmap already has the BitGrid layout, it is copied as a whole. BitGrid
+// only runs B3/S23 on a bounded grid, checkpoints of other rules or of a
+// torus are rejected.
+bool checkpoint_load_bitgrid(BitGrid *bit_grid, const char *path) {
+    CheckpointMapping mapping;
+    if (!checkpoint_map(path, &mapping))
+        return false;
+    if (mapping.header->rule_transitions != LIFERULE_CONWAY_TRANSITIONS ||
+        mapping.header->topology != GOLSTATE_TOPOLOGY_BOUNDED) {
+        checkpoint_unmap(&mapping);
+        return false;
+    }
+    memcpy(bit_grid->cells, mapping.bitmap, CHECKPOINT_BITMAP_SIZE);
+    bit_grid->generation = mapping.header->generation;
+    bit_grid->population = mapping.header->population;
+    checkpoint_unmap(&mapping);
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include "bitgrid.h"
+#include "golstate.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A checkpoint is a CheckpointHeader followed by the grid packed with the
+// BitGrid layout (BITGRID_WORDS words), in native byte order
+#define CHECKPOINT_MAGIC "AGOLCKPT"
+#define CHECKPOINT_MAGIC_SIZE 8
+#define CHECKPOINT_VERSION 2
+
+typedef struct {
+    char magic[CHECKPOINT_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t grid_width;
+    uint32_t row_words;
+    // LifeRule transitions
+    uint32_t rule_transitions;
+    // GolStateTopology the cells were stepped with
+    uint32_t topology;
+    uint64_t generation;
+    uint64_t population;
+    uint64_t bitmap_checksum;
+    // Checksum of the fields above
+    uint64_t header_checksum;
+} CheckpointHeader;
+
+// Read only view of a checkpoint file, bitmap points into the mapping
+typedef struct {
+    void *address;
+    size_t size;
+    const CheckpointHeader *header;
+    const uint64_t *bitmap;
+} CheckpointMapping;
+
+bool checkpoint_map(const char *path, CheckpointMapping *mapping);
+void checkpoint_unmap(CheckpointMapping *mapping);
+// Only GolStates of GRID_WIDTH x GRID_WIDTH cells fit a checkpoint
+bool checkpoint_save_golstate(GolState *gol_state, const char *path);
+bool checkpoint_load_golstate(GolState *gol_state, const char *path);
+bool checkpoint_save_bitgrid(BitGrid *bit_grid, const char *path);
+bool checkpoint_load_bitgrid(BitGrid *bit_grid, const char *path);
+
+#endif // _CHECKPOINT_H_
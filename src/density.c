@@ -0,0 +1,69 @@
+#include "density.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+DensityPyramid *density_alloc() {
+    DensityPyramid *density = malloc(sizeof(*density));
+    if (!density)
+        return NULL;
+    density->counts[0] = NULL;
+    for (int level = 1; level <= DENSITY_LEVELS; level++) {
+        int width = DENSITY_LEVEL_WIDTH(level);
+        density->counts[level] =
+            calloc(width * width, sizeof(*density->counts[level]));
+        if (!density->counts[level]) {
+            density_destroy(&density);
+            return NULL;
+        }
+    }
+    return density;
+}
+
+void density_destroy(DensityPyramid **density) {
+    for (int level = 1; level <= DENSITY_LEVELS; level++) {
+        free((*density)->counts[level]);
+    }
+    free(*density);
+    *density = NULL;
+}
+
+void density_clear(DensityPyramid *density) {
+    for (int level = 1; level <= DENSITY_LEVELS; level++) {
+        int width = DENSITY_LEVEL_WIDTH(level);
+        memset(density->counts[level], 0,
+               width * width * sizeof(*density->counts[level]));
+    }
+}
+
+static inline void density_add(DensityPyramid *density, int grid_index,
+                               int delta) {
+    int x = grid_index % GRID_WIDTH, y = grid_index / GRID_WIDTH;
+    for (int level = 1; level <= DENSITY_LEVELS; level++) {
+        density->counts[level][(y >> level) * DENSITY_LEVEL_WIDTH(level) +
+                               (x >> level)] += delta;
+    }
+}
+
+void density_rebuild(DensityPyramid *density, const int32_t *cells, int len) {
+    density_clear(density);
+    for (int i = 0; i < len; i++) {
+        density_add(density, cells[i], 1);
+    }
+}
+
+// Births are grid indexes and deaths ~grid_index, every change must flip
+// the cell
+void density_apply_changes(DensityPyramid *density, const int32_t *changes,
+                           int len) {
+    for (int i = 0; i < len; i++) {
+        if (changes[i] >= 0)
+            density_add(density, changes[i], 1);
+        else
+            density_add(density, ~changes[i], -1);
+    }
+}
+
+uint16_t density_get(const DensityPyramid *density, int level, int x, int y) {
+    return density->counts[level][y * DENSITY_LEVEL_WIDTH(level) + x];
+}
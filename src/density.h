@@ -0,0 +1,26 @@
+#ifndef _DENSITY_H_
+#define _DENSITY_H_
+
+#include "golstate.h"
+
+#include <stdint.h>
+
+// Level k counts the live cells of each 2^k x 2^k block of the grid, level 0
+// is the grid itself and is not stored
+#define DENSITY_LEVELS 5
+#define DENSITY_LEVEL_WIDTH(level)                                             \
+    ((GRID_WIDTH + (1 << (level)) - 1) >> (level))
+
+typedef struct {
+    uint16_t *counts[DENSITY_LEVELS + 1];
+} DensityPyramid;
+
+DensityPyramid *density_alloc();
+void density_destroy(DensityPyramid **density);
+void density_clear(DensityPyramid *density);
+void density_rebuild(DensityPyramid *density, const int32_t *cells, int len);
+void density_apply_changes(DensityPyramid *density, const int32_t *changes,
+                           int len);
+uint16_t density_get(const DensityPyramid *density, int level, int x, int y);
+
+#endif // _DENSITY_H_
@@ -1,17 +1,152 @@
 #include "golstate.h"
-#include "node.h"
+#include "cellvec.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <time.h>
 
-GolState *golstate_alloc() {
-    GolState *gol_state = malloc(sizeof(*gol_state));
-    memset(gol_state->grid, 0, sizeof(gol_state->grid));
-    memset(gol_state->analyzed_grid_cells, 0, sizeof(gol_state->grid));
-    gol_state->alive_cells = NULL;
-    gol_state->dying_cells = NULL;
-    gol_state->becoming_alive_cells = NULL;
-    gol_state->recycled_cells = NULL;
+#if GOLSTATE_STATS_ENABLED
+static inline uint64_t golstate_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#define GOLSTATE_PHASE_START(phase) uint64_t phase##_start = golstate_now_ns()
+#define GOLSTATE_PHASE_END(gol_state, phase)                                   \
+    ((gol_state)->stats.current.phase_ns[phase] +=                             \
+     golstate_now_ns() - phase##_start)
+#define GOLSTATE_COUNT(gol_state, counter, amount)                             \
+    ((gol_state)->stats.current.counter += (amount))
+#else
+#define GOLSTATE_PHASE_START(phase)
+#define GOLSTATE_PHASE_END(gol_state, phase) ((void)0)
+#define GOLSTATE_COUNT(gol_state, counter, amount) ((void)0)
+#endif
+
+// splitmix64 finalizer, stands for a table of random numbers per cell
+static inline uint64_t golstate_cell_hash(int cell) {
+    uint64_t hash = (uint64_t)cell + 0x9e3779b97f4a7c15;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+    return hash ^ (hash >> 31);
+}
+
+static inline bool golstate_is_border(const GolState *gol_state, int cell) {
+    return (unsigned)golstate_cell_x(gol_state, cell) >=
+               (unsigned)gol_state->width ||
+           (unsigned)golstate_cell_y(gol_state, cell) >=
+               (unsigned)gol_state->height;
+}
+
+// Cell of the grid a border cell of a TORUS grid stands for
+static inline int golstate_wrap(const GolState *gol_state, int cell) {
+    int width = gol_state->width, height = gol_state->height;
+    int x = golstate_cell_x(gol_state, cell);
+    int y = golstate_cell_y(gol_state, cell);
+    x += (x < 0) * width - (x >= width) * width;
+    y += (y < 0) * height - (y >= height) * height;
+    return golstate_cell(gol_state, x, y);
+}
+
+// Copies the opposite edges into the border of a TORUS grid, clears it
+// otherwise
+static void golstate_refresh_border(GolState *gol_state) {
+    bool *grid = gol_state->grid;
+    bool torus = gol_state->topology == GOLSTATE_TOPOLOGY_TORUS;
+    int width = gol_state->width, height = gol_state->height;
+    for (int x = -1; x <= width; x++) {
+        int top = golstate_cell(gol_state, x, -1);
+        int bottom = golstate_cell(gol_state, x, height);
+        grid[top] = torus && grid[golstate_wrap(gol_state, top)];
+        grid[bottom] = torus && grid[golstate_wrap(gol_state, bottom)];
+    }
+    for (int y = 0; y < height; y++) {
+        int left = golstate_cell(gol_state, -1, y);
+        int right = golstate_cell(gol_state, width, y);
+        grid[left] = torus && grid[golstate_wrap(gol_state, left)];
+        grid[right] = torus && grid[golstate_wrap(gol_state, right)];
+    }
+    gol_state->border_stale = false;
+}
+
+// Edited generations do not follow from the ones before
+static void golstate_forget_cycle(GolState *gol_state) {
+    gol_state->cycle.len = 0;
+    gol_state->cycle.period = 0;
+}
+
+// Zero filled and only backed by memory once written
+static void *golstate_map(size_t size) {
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return data == MAP_FAILED ? NULL : data;
+}
+
+static void golstate_unmap(void *data, size_t size) {
+    if (data)
+        munmap(data, size);
+}
+
+// Gives the pages back, they read as zeros when touched again. Callers rely
+// on the zeros, so they are written when the pages cannot be given back.
+static void golstate_release(void *data, size_t size) {
+    if (madvise(data, size, MADV_DONTNEED) != 0)
+        memset(data, 0, size);
+}
+
+// Dimensions whose cell indexes, border included, fit an int32_t. Returns
+// NULL when they do not or memory runs out.
+GolState *golstate_alloc(int width, int height) {
+    if (width < 1 || height < 1 || width > GOLSTATE_MAX_WIDTH ||
+        height > GOLSTATE_MAX_WIDTH)
+        return NULL;
+    int stride_shift = 0;
+    while ((1 << stride_shift) < width + 2)
+        stride_shift++;
+    size_t cells = ((size_t)height + 2) << stride_shift;
+    if (cells > INT32_MAX)
+        return NULL;
+
+    GolState *gol_state = calloc(1, sizeof(*gol_state));
+    if (!gol_state)
+        return NULL;
+    gol_state->width = width;
+    gol_state->height = height;
+    gol_state->stride_shift = stride_shift;
+    gol_state->cells = cells;
+    int stride = 1 << stride_shift;
+    int neighbor_offsets[MAX_NEIGHBORS] = {
+        -stride - 1, -stride, -stride + 1, -1, 1, stride - 1, stride,
+        stride + 1};
+    memcpy(gol_state->neighbor_offsets, neighbor_offsets,
+           sizeof(neighbor_offsets));
+    gol_state->grid = golstate_map(cells * sizeof(*gol_state->grid));
+    gol_state->analysis_marks =
+        golstate_map(cells * sizeof(*gol_state->analysis_marks));
+    gol_state->alive_slots =
+        golstate_map(cells * sizeof(*gol_state->alive_slots));
+    gol_state->neighbor_counts =
+        golstate_map(cells * sizeof(*gol_state->neighbor_counts));
+    gol_state->alive_cells = cellvec_alloc();
+    gol_state->dying_cells = cellvec_alloc();
+    gol_state->becoming_alive_cells = cellvec_alloc();
+    gol_state->candidate_cells = cellvec_alloc();
+    if (!gol_state->grid || !gol_state->analysis_marks ||
+        !gol_state->alive_slots || !gol_state->neighbor_counts ||
+        !gol_state->alive_cells || !gol_state->dying_cells ||
+        !gol_state->becoming_alive_cells || !gol_state->candidate_cells) {
+        golstate_destroy(&gol_state);
+        return NULL;
+    }
+    gol_state->step_mode = GOLSTATE_STEP_SCATTER;
+    gol_state->topology = GOLSTATE_TOPOLOGY_BOUNDED;
+    gol_state->border_stale = false;
+    gol_state->analysis_epoch = 1;
+    gol_state->rule = liferule_conway();
+    gol_state->hash = 0;
+    gol_state->cycle.max_period = GOLSTATE_DEFAULT_CYCLE_PERIOD;
     gol_state->population = 0;
     gol_state->generation = 0;
     gol_state->is_generation_analyzed = false;
@@ -19,239 +154,502 @@ GolState *golstate_alloc() {
 }
 
 void golstate_destroy(GolState **gol_state) {
-    node_destroy_all(&(*gol_state)->alive_cells);
-    node_destroy_all(&(*gol_state)->dying_cells);
-    node_destroy_all(&(*gol_state)->becoming_alive_cells);
-    node_destroy_all(&(*gol_state)->recycled_cells);
+    if (!*gol_state)
+        return;
+    size_t cells = (*gol_state)->cells;
+    golstate_unmap((*gol_state)->grid, cells * sizeof(bool));
+    golstate_unmap((*gol_state)->analysis_marks, cells * sizeof(uint8_t));
+    golstate_unmap((*gol_state)->alive_slots, cells * sizeof(int32_t));
+    golstate_unmap((*gol_state)->neighbor_counts, cells * sizeof(uint8_t));
+    cellvec_destroy(&(*gol_state)->alive_cells);
+    cellvec_destroy(&(*gol_state)->dying_cells);
+    cellvec_destroy(&(*gol_state)->becoming_alive_cells);
+    cellvec_destroy(&(*gol_state)->candidate_cells);
     free(*gol_state);
     *gol_state = NULL;
 }
 
+// Starts a new epoch so every mark is stale, once every 255 generations the
+// marks are released and read back as zero, older than any epoch
+static void golstate_cleanup_analyzed_cells(GolState *gol_state) {
+    if (++gol_state->analysis_epoch != 0)
+        return;
+    golstate_release(gol_state->analysis_marks,
+                     gol_state->cells * sizeof(*gol_state->analysis_marks));
+    gol_state->analysis_epoch = 1;
+    GOLSTATE_COUNT(gol_state, bytes_touched,
+                   gol_state->cells * sizeof(*gol_state->analysis_marks));
+}
+
+// Neighbor counts are already zero after any analysis and the slots of dead
+// cells are never read, only the grid is released
 void golstate_restart(GolState *gol_state) {
-    node_destroy_all(&gol_state->alive_cells);
-    node_destroy_all(&gol_state->becoming_alive_cells);
-    node_destroy_all(&gol_state->dying_cells);
-    node_destroy_all(&gol_state->recycled_cells);
+    cellvec_clear(gol_state->alive_cells);
+    cellvec_clear(gol_state->becoming_alive_cells);
+    cellvec_clear(gol_state->dying_cells);
     gol_state->population = 0;
     gol_state->generation = 0;
     gol_state->is_generation_analyzed = false;
-    memset(gol_state->grid, 0, sizeof(gol_state->grid));
-    memset(gol_state->analyzed_grid_cells, 0, sizeof(gol_state->grid));
-}
-
-static void golstate_insert_cell(GolState *gol_state, Node **cell_ubication,
-                                 int grid_index) {
-    if (gol_state->recycled_cells) {
-        Node *new_cell = node_pop(&gol_state->recycled_cells);
-        new_cell->data = grid_index;
-        node_insert_head_node(cell_ubication, new_cell);
-    } else {
-        node_insert_head(cell_ubication, grid_index);
-    }
-}
-
-static void golstate_cleanup_analyzed_cells(GolState *gol_state) {
-    memset(gol_state->analyzed_grid_cells, 0, sizeof(gol_state->analyzed_grid_cells));
+    golstate_release(gol_state->grid, gol_state->cells * sizeof(bool));
+    golstate_cleanup_analyzed_cells(gol_state);
+    memset(&gol_state->stats, 0, sizeof(gol_state->stats));
+    gol_state->border_stale = false;
+    gol_state->hash = 0;
+    golstate_forget_cycle(gol_state);
 }
 
+// Compacts the cells still alive to the front, keeping their order
 static void golstate_cleanup_alive_cells(GolState *gol_state) {
-    Node *new_alive_cells = NULL;
-    Node *current = node_pop(&gol_state->alive_cells);
-    while (current) {
-        if (!gol_state->grid[current->data]) {
-            node_insert_head_node(&gol_state->recycled_cells, current);
-        } else {
-            node_insert_head_node(&new_alive_cells, current);
+    CellVec *alive_cells = gol_state->alive_cells;
+    int len = 0;
+    for (int i = 0; i < alive_cells->len; i++) {
+        int32_t cell = alive_cells->data[i];
+        if (gol_state->grid[cell]) {
+            gol_state->alive_slots[cell] = len;
+            alive_cells->data[len++] = cell;
         }
-        current = node_pop(&gol_state->alive_cells);
     }
-    gol_state->alive_cells = new_alive_cells;
+    alive_cells->len = len;
 }
 
 static void golstate_cleanup(GolState *gol_state) {
-    golstate_cleanup_analyzed_cells(gol_state);
+    if (gol_state->step_mode == GOLSTATE_STEP_NEIGHBORHOOD) {
+        GOLSTATE_PHASE_START(GOLSTATE_PHASE_CLEANUP_ANALYZED);
+        golstate_cleanup_analyzed_cells(gol_state);
+        GOLSTATE_PHASE_END(gol_state, GOLSTATE_PHASE_CLEANUP_ANALYZED);
+    }
+    GOLSTATE_PHASE_START(GOLSTATE_PHASE_CLEANUP_ALIVE);
+    // Reads each entry and its grid cell, writes back the entry and slot
+    GOLSTATE_COUNT(gol_state, bytes_touched,
+                   gol_state->alive_cells->len *
+                       (3 * sizeof(int32_t) + sizeof(bool)));
     golstate_cleanup_alive_cells(gol_state);
+    GOLSTATE_PHASE_END(gol_state, GOLSTATE_PHASE_CLEANUP_ALIVE);
+}
+
+void golstate_set_step_mode(GolState *gol_state, GolStateStepMode step_mode) {
+    gol_state->step_mode = step_mode;
+    golstate_cleanup_analyzed_cells(gol_state);
+}
+
+// Takes effect from the next analyzed generation
+void golstate_set_rule(GolState *gol_state, LifeRule rule) {
+    gol_state->rule = rule;
+    golstate_forget_cycle(gol_state);
+}
+
+void golstate_set_topology(GolState *gol_state, GolStateTopology topology) {
+    gol_state->topology = topology;
+    golstate_refresh_border(gol_state);
+    golstate_forget_cycle(gol_state);
+}
+
+// 0 disables the detection, the hash is still kept
+void golstate_set_cycle_detection(GolState *gol_state, int max_period) {
+    if (max_period < 0)
+        max_period = 0;
+    if (max_period > GOLSTATE_MAX_CYCLE_PERIOD)
+        max_period = GOLSTATE_MAX_CYCLE_PERIOD;
+    gol_state->cycle.max_period = max_period;
+    golstate_forget_cycle(gol_state);
+}
+
+// Returns whether the current generation repeats one of the last max_period
+// ones. A still life has period 1.
+bool golstate_get_cycle(GolState *gol_state, int *period,
+                        int *start_generation) {
+    if (!gol_state->cycle.period)
+        return false;
+    if (period)
+        *period = gol_state->cycle.period;
+    if (start_generation)
+        *start_generation = gol_state->cycle.start_generation;
+    return true;
 }
 
 void golstate_arbitrary_give_birth_cell(GolState *gol_state, int grid_index) {
-    if (grid_index < 0 || grid_index >= GRID_SIZE ||
-        gol_state->grid[grid_index]) {
+    if (grid_index < 0 || grid_index >= gol_state->width * gol_state->height)
         return;
-    }
-    golstate_insert_cell(gol_state, &gol_state->alive_cells, grid_index);
-    gol_state->grid[grid_index] = true;
+    int cell = golstate_cell_of(gol_state, grid_index);
+    if (gol_state->grid[cell])
+        return;
+    gol_state->alive_slots[cell] = gol_state->alive_cells->len;
+    cellvec_push(gol_state->alive_cells, cell);
+    gol_state->grid[cell] = true;
     gol_state->population++;
+    gol_state->hash ^= golstate_cell_hash(cell);
+    gol_state->border_stale = true;
+    golstate_forget_cycle(gol_state);
 }
 
 void golstate_arbitrary_kill_cell(GolState *gol_state, int grid_index) {
-    if (grid_index < 0 || grid_index >= GRID_SIZE)
+    if (grid_index < 0 || grid_index >= gol_state->width * gol_state->height)
         return;
-    if (!gol_state->grid[grid_index])
+    int cell = golstate_cell_of(gol_state, grid_index);
+    if (!gol_state->grid[cell])
         return;
-    node_delete_by_data(&gol_state->alive_cells, grid_index);
-    gol_state->grid[grid_index] = false;
+    // The last alive cell takes the slot of the killed one
+    CellVec *alive_cells = gol_state->alive_cells;
+    int slot = gol_state->alive_slots[cell];
+    int32_t last_cell = alive_cells->data[alive_cells->len - 1];
+    cellvec_swap_remove(alive_cells, slot);
+    gol_state->alive_slots[last_cell] = slot;
+    gol_state->grid[cell] = false;
     gol_state->population--;
+    gol_state->hash ^= golstate_cell_hash(cell);
+    gol_state->border_stale = true;
+    golstate_forget_cycle(gol_state);
 }
 
-#define START_IS_IN_CORRECT_INDEX(s, l)                                        \
-    (s >= 0 && (s == 0 ? 0 : s / GRID_WIDTH) == l)
-static int golstate_get_neighborhood_start(int neighborhood_center,
-                                           int line_of_neighborhood_center) {
-    int start;
-    for (int offset = 1; offset >= -1; offset--) {
-        start = neighborhood_center - (GRID_WIDTH + offset);
-        if (START_IS_IN_CORRECT_INDEX(start, line_of_neighborhood_center - 1)) {
-            return start;
-        }
+void golstate_give_birth_cells(GolState *gol_state, const int *grid_indexes,
+                               int count) {
+    // Cells already alive are not added again, so the sum can be too large
+    if (count <= INT32_MAX - gol_state->alive_cells->len)
+        cellvec_reserve(gol_state->alive_cells,
+                        gol_state->alive_cells->len + count);
+    for (int i = 0; i < count; i++) {
+        golstate_arbitrary_give_birth_cell(gol_state, grid_indexes[i]);
     }
-    start = neighborhood_center - 1;
-    if (START_IS_IN_CORRECT_INDEX(start, line_of_neighborhood_center)) {
-        return start;
-    }
-    return neighborhood_center;
-}
-
-#define END_IS_IN_CORRECT_INDEX(e, l)                                          \
-    (e < GRID_SIZE && (e == 0 ? 0 : e / GRID_WIDTH) == l)
-static int golstate_get_neighborhood_end(int neighborhood_center,
-                                         int line_of_neighborhood_center) {
-    int end;
-    for (int offset = 1; offset >= -1; offset--) {
-        end = neighborhood_center + (GRID_WIDTH + offset);
-        if (END_IS_IN_CORRECT_INDEX(end, line_of_neighborhood_center + 1)) {
-            return end;
-        }
+}
+
+void golstate_kill_cells(GolState *gol_state, const int *grid_indexes,
+                         int count) {
+    for (int i = 0; i < count; i++) {
+        golstate_arbitrary_kill_cell(gol_state, grid_indexes[i]);
     }
-    end = neighborhood_center + 1;
-    if (END_IS_IN_CORRECT_INDEX(end, line_of_neighborhood_center)) {
-        return end;
+}
+
+// Grid indexes of the live cells, in the order of alive_cells
+void golstate_get_grid_indexes(GolState *gol_state, CellVec *grid_indexes) {
+    CellVec *alive_cells = gol_state->alive_cells;
+    cellvec_clear(grid_indexes);
+    cellvec_reserve(grid_indexes, alive_cells->len);
+    for (int i = 0; i < alive_cells->len; i++) {
+        grid_indexes->data[i] =
+            golstate_grid_index_of(gol_state, alive_cells->data[i]);
     }
-    return neighborhood_center;
+    grid_indexes->len = alive_cells->len;
 }
 
+// Neighbors in the border are read as they are, dead or copies of the
+// opposite edges, and gathered as the cells they stand for
 static void golstate_neighborhood_analysis(GolState *gol_state,
                                            int neighborhood_center,
-                                           Node **list_of_indexes_dst,
+                                           int *indexes_dst, int *index_count,
                                            int *life_in_neighborhood,
                                            bool gather_indexes) {
-    if (neighborhood_center < 0 || neighborhood_center >= GRID_SIZE)
-        return;
-
     *life_in_neighborhood = 0;
-    if (gather_indexes && *list_of_indexes_dst) {
-        node_destroy_all(list_of_indexes_dst);
+    if (gather_indexes)
+        *index_count = 0;
+
+    for (int n = 0; n < MAX_NEIGHBORS; n++) {
+        int neighbor = neighborhood_center + gol_state->neighbor_offsets[n];
+        bool alive = gol_state->grid[neighbor];
+        *life_in_neighborhood += alive;
+        if (gather_indexes && !alive)
+            indexes_dst[(*index_count)++] = neighbor;
     }
+    gol_state->analysis_marks[neighborhood_center] = gol_state->analysis_epoch;
+    GOLSTATE_COUNT(gol_state, cells_examined, 1);
+    GOLSTATE_COUNT(gol_state, bytes_touched,
+                   (MAX_NEIGHBORS + 2) * sizeof(bool));
+}
 
-    int neighborhood_center_line =
-        neighborhood_center == 0 ? 0 : neighborhood_center / GRID_WIDTH;
-    int neighborhood_start = golstate_get_neighborhood_start(
-        neighborhood_center, neighborhood_center_line);
-    int neighborhood_end = golstate_get_neighborhood_end(
-        neighborhood_center, neighborhood_center_line);
-
-    int neighborhood_end_of_first_line = neighborhood_center - (GRID_WIDTH - 1);
-    int neighborhood_end_of_second_line = neighborhood_center + 1;
-    int jump_to_start_of_nextline = GRID_WIDTH - 4;
-    int current_line =
-        neighborhood_center_line - 1 < 0 ? 0 : neighborhood_center_line - 1;
-    for (int i = neighborhood_start; i <= neighborhood_end; i++) {
-        if (i < 0 || i == neighborhood_center)
-            continue;
-        if (i >= GRID_SIZE)
-            break;
-        if (i == neighborhood_end_of_first_line + 1 ||
-            i == neighborhood_end_of_second_line + 1) {
-            i += jump_to_start_of_nextline;
-            current_line++;
-            continue;
-        }
+static void golstate_scatter_neighbors(GolState *gol_state, int cell) {
+    for (int n = 0; n < MAX_NEIGHBORS; n++) {
+        int neighbor = cell + gol_state->neighbor_offsets[n];
+        if (!gol_state->neighbor_counts[neighbor])
+            cellvec_push(gol_state->candidate_cells, neighbor);
+        gol_state->neighbor_counts[neighbor]++;
+    }
+}
 
-        if (i / GRID_WIDTH != current_line) {
-            continue;
-        }
-        if (gather_indexes && !gol_state->grid[i])
-            node_insert_head(list_of_indexes_dst, i);
+// Adds the counts scattered into the border of a TORUS grid to the cells on
+// the opposite edges
+static void golstate_fold_border_cell(GolState *gol_state, int cell) {
+    uint8_t count = gol_state->neighbor_counts[cell];
+    if (!count)
+        return;
+    int wrapped = golstate_wrap(gol_state, cell);
+    if (!gol_state->neighbor_counts[wrapped])
+        cellvec_push(gol_state->candidate_cells, wrapped);
+    gol_state->neighbor_counts[wrapped] += count;
+}
 
-        if (gol_state->grid[i])
-            (*life_in_neighborhood)++;
+static void golstate_fold_border(GolState *gol_state) {
+    int width = gol_state->width, height = gol_state->height;
+    for (int x = -1; x <= width; x++) {
+        golstate_fold_border_cell(gol_state, golstate_cell(gol_state, x, -1));
+        golstate_fold_border_cell(gol_state,
+                                  golstate_cell(gol_state, x, height));
+    }
+    for (int y = 0; y < height; y++) {
+        golstate_fold_border_cell(gol_state, golstate_cell(gol_state, -1, y));
+        golstate_fold_border_cell(gol_state,
+                                  golstate_cell(gol_state, width, y));
     }
-    gol_state->analyzed_grid_cells[neighborhood_center] = true;
 }
 
-static bool golstate_cell_stays_alive(int life_in_neighborhood) {
-    return life_in_neighborhood >= MIN_NEIGHBORS_TO_SURVIVE &&
-           life_in_neighborhood <= MAX_NEIGHBORS_TO_STAY_ALIVE;
+// Inlined with a constant transitions for B3/S23 so the lookups fold into
+// the comparisons of a hard coded rule
+static inline void golstate_decide_scatter(GolState *gol_state,
+                                           uint32_t transitions) {
+    CellVec *alive_cells = gol_state->alive_cells;
+    for (int i = 0; i < alive_cells->len; i++) {
+        int32_t cell = alive_cells->data[i];
+        if (!liferule_next_state(transitions, true,
+                                 gol_state->neighbor_counts[cell]))
+            cellvec_push(gol_state->dying_cells, cell);
+    }
+
+    CellVec *candidate_cells = gol_state->candidate_cells;
+    for (int i = 0; i < candidate_cells->len; i++) {
+        int32_t cell = candidate_cells->data[i];
+        // Cells in the border are never born, their counts are folded or
+        // belong to no cell
+        if (!gol_state->grid[cell] &&
+            liferule_next_state(transitions, false,
+                                gol_state->neighbor_counts[cell]) &&
+            !golstate_is_border(gol_state, cell))
+            cellvec_push(gol_state->becoming_alive_cells, cell);
+        gol_state->neighbor_counts[cell] = 0;
+    }
+    cellvec_clear(candidate_cells);
 }
 
-static bool golstate_dead_cell_becomes_alive(int life_in_neighborhood) {
-    return life_in_neighborhood == NEIGHBORS_TO_REPRODUCE;
+// Counts are scattered from the live cells, then births and deaths are
+// decided in linear passes over the live cells and the touched cells
+static void golstate_analyze_generation_scatter(GolState *gol_state) {
+    CellVec *alive_cells = gol_state->alive_cells;
+    for (int i = 0; i < alive_cells->len; i++) {
+        golstate_scatter_neighbors(gol_state, alive_cells->data[i]);
+    }
+    if (gol_state->topology == GOLSTATE_TOPOLOGY_TORUS)
+        golstate_fold_border(gol_state);
+
+    if (liferule_is_conway(gol_state->rule))
+        golstate_decide_scatter(gol_state, LIFERULE_CONWAY_TRANSITIONS);
+    else
+        golstate_decide_scatter(gol_state, gol_state->rule.transitions);
 }
 
 void golstate_analyze_generation(GolState *gol_state) {
+    GOLSTATE_PHASE_START(GOLSTATE_PHASE_ANALYZE);
+    if (gol_state->step_mode == GOLSTATE_STEP_SCATTER) {
+        // Live cells are read twice and each scatters into 8 counts, touched
+        // cells are read and cleared
+        GOLSTATE_COUNT(gol_state, cells_examined,
+                       gol_state->alive_cells->len);
+        GOLSTATE_COUNT(gol_state, bytes_touched,
+                       gol_state->alive_cells->len *
+                           (2 * sizeof(int32_t) + MAX_NEIGHBORS));
+        golstate_analyze_generation_scatter(gol_state);
+        GOLSTATE_COUNT(gol_state, cells_examined,
+                       gol_state->candidate_cells->len);
+        GOLSTATE_PHASE_END(gol_state, GOLSTATE_PHASE_ANALYZE);
+        gol_state->is_generation_analyzed = true;
+        return;
+    }
+
+    if (gol_state->border_stale &&
+        gol_state->topology == GOLSTATE_TOPOLOGY_TORUS)
+        golstate_refresh_border(gol_state);
+
     // Analyze current cell
-    Node *current_cell = gol_state->alive_cells;
-    while (current_cell) {
+    uint32_t transitions = gol_state->rule.transitions;
+    CellVec *alive_cells = gol_state->alive_cells;
+    for (int c = 0; c < alive_cells->len; c++) {
+        int32_t current_cell = alive_cells->data[c];
 
         int life_in_neighborhood = 0;
-        Node *neighborhood = NULL;
-        golstate_neighborhood_analysis(gol_state, current_cell->data,
-                                       &neighborhood, &life_in_neighborhood,
-                                       true);
-        if (!golstate_cell_stays_alive(life_in_neighborhood)) {
-            golstate_insert_cell(gol_state, &gol_state->dying_cells,
-                                 current_cell->data);
+        int neighborhood[MAX_NEIGHBORS];
+        int neighborhood_len = 0;
+        golstate_neighborhood_analysis(gol_state, current_cell, neighborhood,
+                                       &neighborhood_len,
+                                       &life_in_neighborhood, true);
+        if (!liferule_next_state(transitions, true, life_in_neighborhood)) {
+            cellvec_push(gol_state->dying_cells, current_cell);
         }
 
         // Analyze each dead cell in neighborhood
-        Node *current_neighborhood_cell = neighborhood;
-        while (current_neighborhood_cell) {
-            if (gol_state->grid[current_neighborhood_cell->data] ||
-                gol_state
-                    ->analyzed_grid_cells[current_neighborhood_cell->data]) {
-                current_neighborhood_cell = current_neighborhood_cell->next;
+        for (int n = 0; n < neighborhood_len; n++) {
+            int neighborhood_cell = neighborhood[n];
+            if (golstate_is_border(gol_state, neighborhood_cell)) {
+                if (gol_state->topology == GOLSTATE_TOPOLOGY_BOUNDED)
+                    continue;
+                neighborhood_cell = golstate_wrap(gol_state, neighborhood_cell);
+            }
+            if (gol_state->grid[neighborhood_cell] ||
+                gol_state->analysis_marks[neighborhood_cell] ==
+                    gol_state->analysis_epoch) {
                 continue;
             }
 
-            golstate_neighborhood_analysis(gol_state,
-                                           current_neighborhood_cell->data,
-                                           NULL, &life_in_neighborhood, false);
-
-            if (golstate_dead_cell_becomes_alive(life_in_neighborhood)) {
-                golstate_insert_cell(gol_state,
-                                     &gol_state->becoming_alive_cells,
-                                     current_neighborhood_cell->data);
-                gol_state
-                    ->analyzed_grid_cells[current_neighborhood_cell->data] =
-                    true;
-            }
+            golstate_neighborhood_analysis(gol_state, neighborhood_cell, NULL,
+                                           NULL, &life_in_neighborhood,
+                                           false);
 
-            current_neighborhood_cell = current_neighborhood_cell->next;
+            if (liferule_next_state(transitions, false,
+                                    life_in_neighborhood)) {
+                cellvec_push(gol_state->becoming_alive_cells,
+                             neighborhood_cell);
+                gol_state->analysis_marks[neighborhood_cell] =
+                    gol_state->analysis_epoch;
+            }
         }
-        node_destroy_all(&neighborhood);
-        current_cell = current_cell->next;
     }
+    GOLSTATE_PHASE_END(gol_state, GOLSTATE_PHASE_ANALYZE);
     gol_state->is_generation_analyzed = true;
 }
 
+#if GOLSTATE_STATS_ENABLED
+// Cleared vectors keep their buffers, so blocks only grow in number or size
+static void golstate_measure_storage(GolState *gol_state) {
+    CellVec *cell_vecs[] = {gol_state->alive_cells, gol_state->dying_cells,
+                            gol_state->becoming_alive_cells,
+                            gol_state->candidate_cells};
+    GolStateStats *stats = &gol_state->stats;
+    size_t storage_bytes = 0, live_bytes = 0;
+    int blocks = 0;
+    for (size_t i = 0; i < sizeof(cell_vecs) / sizeof(*cell_vecs); i++) {
+        storage_bytes += (size_t)cell_vecs[i]->capacity * sizeof(int32_t);
+        live_bytes += (size_t)cell_vecs[i]->len * sizeof(int32_t);
+        blocks += cell_vecs[i]->data != NULL;
+    }
+    if (storage_bytes > stats->storage_bytes)
+        stats->current.storage_grows++;
+    if (storage_bytes > stats->storage_peak_bytes)
+        stats->storage_peak_bytes = storage_bytes;
+    stats->storage_bytes = storage_bytes;
+    stats->storage_live_bytes = live_bytes;
+    stats->storage_blocks = blocks;
+}
+
+// Closes the stats of the generation just stepped
+static void golstate_finish_stats(GolState *gol_state) {
+    GolStateStats *stats = &gol_state->stats;
+    golstate_measure_storage(gol_state);
+
+    for (int phase = 0; phase < GOLSTATE_PHASES; phase++) {
+        stats->total.phase_ns[phase] += stats->current.phase_ns[phase];
+    }
+    stats->total.cells_examined += stats->current.cells_examined;
+    stats->total.births += stats->current.births;
+    stats->total.deaths += stats->current.deaths;
+    stats->total.bytes_touched += stats->current.bytes_touched;
+    stats->total.storage_grows += stats->current.storage_grows;
+
+    stats->last = stats->current;
+    stats->window[stats->window_next] = stats->current;
+    stats->window_next = (stats->window_next + 1) % GOLSTATE_STATS_WINDOW;
+    if (stats->window_len < GOLSTATE_STATS_WINDOW)
+        stats->window_len++;
+    stats->generations++;
+    memset(&stats->current, 0, sizeof(stats->current));
+}
+#endif
+
+// Called once the generation is stepped, compares its hash with the ones
+// before it
+static void golstate_detect_cycle(GolState *gol_state) {
+    GolStateCycle *cycle = &gol_state->cycle;
+    int period = 0;
+    for (int k = 1; k <= cycle->len; k++) {
+        int slot = (cycle->next - k + GOLSTATE_MAX_CYCLE_PERIOD) %
+                   GOLSTATE_MAX_CYCLE_PERIOD;
+        if (cycle->hashes[slot] == gol_state->hash) {
+            period = k;
+            break;
+        }
+    }
+    // A cycle keeps the generation it was first seen at while it lasts
+    if (period != cycle->period && period)
+        cycle->start_generation = gol_state->generation - period;
+    cycle->period = period;
+}
+
+static void golstate_remember_hash(GolState *gol_state) {
+    GolStateCycle *cycle = &gol_state->cycle;
+    if (!cycle->max_period)
+        return;
+    cycle->hashes[cycle->next] = gol_state->hash;
+    cycle->next = (cycle->next + 1) % GOLSTATE_MAX_CYCLE_PERIOD;
+    if (cycle->len < cycle->max_period)
+        cycle->len++;
+}
+
 void golstate_next_generation(GolState *gol_state) {
     if (!gol_state->is_generation_analyzed)
         return;
-    Node *current = gol_state->dying_cells;
-    while (current) {
-        gol_state->grid[current->data] = false;
-        gol_state->population--;
-        current = current->next;
+    golstate_remember_hash(gol_state);
+    GOLSTATE_PHASE_START(GOLSTATE_PHASE_APPLY);
+    GOLSTATE_COUNT(gol_state, deaths, gol_state->dying_cells->len);
+    GOLSTATE_COUNT(gol_state, births, gol_state->becoming_alive_cells->len);
+    GOLSTATE_COUNT(gol_state, bytes_touched,
+                   (gol_state->dying_cells->len +
+                    2 * gol_state->becoming_alive_cells->len) *
+                       (sizeof(int32_t) + sizeof(bool)));
+    CellVec *dying_cells = gol_state->dying_cells;
+    uint64_t hash = gol_state->hash;
+    for (int i = 0; i < dying_cells->len; i++) {
+        gol_state->grid[dying_cells->data[i]] = false;
+        hash ^= golstate_cell_hash(dying_cells->data[i]);
     }
-    node_concat(&gol_state->recycled_cells, &gol_state->dying_cells);
+    gol_state->population -= dying_cells->len;
+    cellvec_clear(dying_cells);
 
-    current = gol_state->becoming_alive_cells;
-    while (current) {
-        gol_state->grid[current->data] = true;
-        gol_state->population++;
-        current = current->next;
+    CellVec *becoming_alive_cells = gol_state->becoming_alive_cells;
+    for (int i = 0; i < becoming_alive_cells->len; i++) {
+        gol_state->grid[becoming_alive_cells->data[i]] = true;
+        hash ^= golstate_cell_hash(becoming_alive_cells->data[i]);
     }
-    node_concat(&gol_state->alive_cells, &gol_state->becoming_alive_cells);
+    gol_state->hash = hash;
+    gol_state->border_stale = true;
+    gol_state->population += becoming_alive_cells->len;
+    cellvec_append(gol_state->alive_cells, becoming_alive_cells);
+    cellvec_clear(becoming_alive_cells);
+    GOLSTATE_PHASE_END(gol_state, GOLSTATE_PHASE_APPLY);
     golstate_cleanup(gol_state);
+#if GOLSTATE_STATS_ENABLED
+    golstate_finish_stats(gol_state);
+#endif
     gol_state->generation++;
     gol_state->is_generation_analyzed = false;
+    if (gol_state->cycle.max_period)
+        golstate_detect_cycle(gol_state);
+}
+
+// window_total, when given, receives the sum of the generations in the window
+void golstate_get_stats(GolState *gol_state, GolStateStats *stats,
+                        GolStateGenerationStats *window_total) {
+    *stats = gol_state->stats;
+    if (!window_total)
+        return;
+    memset(window_total, 0, sizeof(*window_total));
+    for (int i = 0; i < stats->window_len; i++) {
+        GolStateGenerationStats *generation = &stats->window[i];
+        for (int phase = 0; phase < GOLSTATE_PHASES; phase++) {
+            window_total->phase_ns[phase] += generation->phase_ns[phase];
+        }
+        window_total->cells_examined += generation->cells_examined;
+        window_total->births += generation->births;
+        window_total->deaths += generation->deaths;
+        window_total->bytes_touched += generation->bytes_touched;
+        window_total->storage_grows += generation->storage_grows;
+    }
+}
+
+const char *golstate_phase_name(GolStatePhase phase) {
+    switch (phase) {
+    case GOLSTATE_PHASE_ANALYZE:
+        return "analyze";
+    case GOLSTATE_PHASE_APPLY:
+        return "apply";
+    case GOLSTATE_PHASE_CLEANUP_ANALYZED:
+        return "cleanup_analyzed";
+    case GOLSTATE_PHASE_CLEANUP_ALIVE:
+        return "cleanup_alive";
+    default:
+        return "unknown";
+    }
 }
@@ -1,35 +1,175 @@
 #ifndef _GOLSTATE_H_
 #define _GOLSTATE_H_
 
-#include "node.h"
+#include "cellvec.h"
+#include "liferule.h"
 #include <math.h>
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+// World of the simulation, BitGrid and checkpoints, a GolState can be given
+// other dimensions
 #define GRID_WIDTH 2000
 #define GRID_SIZE GRID_WIDTH *GRID_WIDTH
 
+#define MAX_NEIGHBORS 8
+// Cell indexes are int32_t, so wide grids are also limited in height
+#define GOLSTATE_MAX_WIDTH 100000
+
+// BOUNDED grids are surrounded by dead cells, TORUS grids wrap around and
+// their border holds copies of the opposite edges
+typedef enum {
+    GOLSTATE_TOPOLOGY_BOUNDED,
+    GOLSTATE_TOPOLOGY_TORUS
+} GolStateTopology;
+
+// SCATTER adds each live cell to the counts of its neighbors in one pass,
+// NEIGHBORHOOD reads the neighborhood of every live cell and dead neighbor
+typedef enum {
+    GOLSTATE_STEP_SCATTER,
+    GOLSTATE_STEP_NEIGHBORHOOD
+} GolStateStepMode;
+
+// Phase timers and counters are built in unless GOLSTATE_NO_STATS is defined
+#ifndef GOLSTATE_NO_STATS
+#define GOLSTATE_STATS_ENABLED 1
+#else
+#define GOLSTATE_STATS_ENABLED 0
+#endif
+#define GOLSTATE_STATS_WINDOW 64
+
+typedef enum {
+    GOLSTATE_PHASE_ANALYZE,
+    GOLSTATE_PHASE_APPLY,
+    GOLSTATE_PHASE_CLEANUP_ANALYZED,
+    GOLSTATE_PHASE_CLEANUP_ALIVE,
+    GOLSTATE_PHASES
+} GolStatePhase;
+
+// bytes_touched is an estimate from the sizes of the arrays each phase reads
+// and writes, storage_grows counts generations where the cell vectors had to
+// grow
 typedef struct {
-    bool grid[GRID_SIZE];
-    bool analyzed_grid_cells[GRID_SIZE];
-    Node *alive_cells;
-    Node *dying_cells;
-    Node *becoming_alive_cells;
-    Node *recycled_cells;
+    uint64_t phase_ns[GOLSTATE_PHASES];
+    uint64_t cells_examined, births, deaths, bytes_touched, storage_grows;
+} GolStateGenerationStats;
+
+typedef struct {
+    // Generation being stepped, the last stepped one and the whole run
+    GolStateGenerationStats current, last, total;
+    // Ring of the last GOLSTATE_STATS_WINDOW generations
+    GolStateGenerationStats window[GOLSTATE_STATS_WINDOW];
+    int window_len, window_next;
+    uint64_t generations;
+    // Cell vectors after the last generation: bytes reserved, bytes holding
+    // cells, the most bytes ever reserved and the buffers backing them
+    size_t storage_bytes, storage_live_bytes, storage_peak_bytes;
+    int storage_blocks;
+} GolStateStats;
+
+// Periods of up to max_period generations are detected, max_period is at
+// most GOLSTATE_MAX_CYCLE_PERIOD
+#define GOLSTATE_MAX_CYCLE_PERIOD 64
+#define GOLSTATE_DEFAULT_CYCLE_PERIOD 30
+
+typedef struct {
+    // Hashes of the generations before the current one, the last at next - 1
+    uint64_t hashes[GOLSTATE_MAX_CYCLE_PERIOD];
+    int len, next, max_period;
+    // Smallest period the current generation repeats with and the first
+    // generation of the cycle, period is 0 when there is none
+    int period, start_generation;
+} GolStateCycle;
+
+// Cells are stored in rows of 1 << stride_shift, a power of two, with a
+// border one cell wide around the grid so the 8 neighbors of every cell are
+// at neighbor_offsets. The API takes grid indexes, y * width + x, while the
+// arrays and vectors of GolState hold these cell indexes. The arrays are
+// anonymous mappings of cells entries, pages never touched take no memory.
+typedef struct {
+    int width, height, stride_shift;
+    size_t cells;
+    int neighbor_offsets[MAX_NEIGHBORS];
+    bool *grid;
+    // A cell was analyzed in the current generation when its mark equals
+    // analysis_epoch, the marks are only released when the epoch wraps around
+    uint8_t *analysis_marks;
+    uint8_t analysis_epoch;
+    CellVec *alive_cells;
+    // Position in alive_cells of every alive cell
+    int32_t *alive_slots;
+    CellVec *dying_cells;
+    CellVec *becoming_alive_cells;
+    // Live neighbors of the cells touched by the scatter pass, zero between
+    // analyses
+    uint8_t *neighbor_counts;
+    CellVec *candidate_cells;
+    GolStateStepMode step_mode;
+    // Kept across restarts, border_stale is set when the copies in the border
+    // of a TORUS grid have to be refreshed
+    GolStateTopology topology;
+    bool border_stale;
+    // B3/S23 unless changed, kept across restarts
+    LifeRule rule;
+    // XOR of the hashes of the live cells, kept on every birth and death
+    uint64_t hash;
+    GolStateCycle cycle;
+    GolStateStats stats;
     int population, generation;
     bool is_generation_analyzed;
 } GolState;
 
-#define MIN_NEIGHBORS_TO_SURVIVE 2
-#define MAX_NEIGHBORS_TO_STAY_ALIVE 3
-#define NEIGHBORS_TO_REPRODUCE 3
+static inline int golstate_cell(const GolState *gol_state, int x, int y) {
+    return ((y + 1) << gol_state->stride_shift) + x + 1;
+}
+
+static inline int golstate_cell_x(const GolState *gol_state, int cell) {
+    return (cell & ((1 << gol_state->stride_shift) - 1)) - 1;
+}
+
+static inline int golstate_cell_y(const GolState *gol_state, int cell) {
+    return (cell >> gol_state->stride_shift) - 1;
+}
+
+static inline int golstate_cell_of(const GolState *gol_state,
+                                   int grid_index) {
+    return golstate_cell(gol_state, grid_index % gol_state->width,
+                         grid_index / gol_state->width);
+}
+
+static inline int golstate_grid_index_of(const GolState *gol_state,
+                                         int cell) {
+    return golstate_cell_y(gol_state, cell) * gol_state->width +
+           golstate_cell_x(gol_state, cell);
+}
+
+static inline bool golstate_is_cell_alive(const GolState *gol_state,
+                                          int grid_index) {
+    return gol_state->grid[golstate_cell_of(gol_state, grid_index)];
+}
 
-GolState *golstate_alloc();
+GolState *golstate_alloc(int width, int height);
 void golstate_destroy(GolState **gol_state);
 void golstate_restart(GolState *gol_state);
+void golstate_set_step_mode(GolState *gol_state, GolStateStepMode step_mode);
+void golstate_set_rule(GolState *gol_state, LifeRule rule);
+void golstate_set_topology(GolState *gol_state, GolStateTopology topology);
+void golstate_set_cycle_detection(GolState *gol_state, int max_period);
+bool golstate_get_cycle(GolState *gol_state, int *period,
+                        int *start_generation);
 void golstate_arbitrary_give_birth_cell(GolState *gol_state, int grid_index);
 void golstate_arbitrary_kill_cell(GolState *gol_state, int grid_index);
+void golstate_give_birth_cells(GolState *gol_state, const int *grid_indexes,
+                               int count);
+void golstate_kill_cells(GolState *gol_state, const int *grid_indexes,
+                         int count);
+void golstate_get_grid_indexes(GolState *gol_state, CellVec *grid_indexes);
 void golstate_analyze_generation(GolState *gol_state);
 void golstate_next_generation(GolState *gol_state);
+void golstate_get_stats(GolState *gol_state, GolStateStats *stats,
+                        GolStateGenerationStats *window_total);
+const char *golstate_phase_name(GolStatePhase phase);
 
 #endif // _GOLSTATE_H_
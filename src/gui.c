@@ -1,6 +1,19 @@
 #include "gui.h"
+#include "raster.h"
+#include "rle.h"
+#include <string.h>
 #include <time.h>
 
+// Generations per second selected with [ and ], the last one is unlimited
+static const int gui_speeds[] = {
+    1, 2, 5, 10, 15, 30, 60, 120, 240, 480, 960, SIMULATION_UNLIMITED_GPS};
+#define GUI_SPEEDS (int)(sizeof(gui_speeds) / sizeof(*gui_speeds))
+
+// Rules cycled with B
+static const char *gui_rules[] = {"B3/S23", "B36/S23", "B3678/S34678",
+                                  "B2/S", "B3/S012345678"};
+#define GUI_RULES (int)(sizeof(gui_rules) / sizeof(*gui_rules))
+
 static void check_sdl_ptr(void *sdl_ptr) {
     if (!sdl_ptr) {
         fprintf(stderr, "Error: SDL2 null pointer (SDL error: \"%s\")\n",
@@ -23,9 +36,26 @@ Gui *gui_alloc() {
     check_sdl_ptr(new_gui->renderer);
     SDL_RenderClear(new_gui->renderer);
 
+    new_gui->cells_texture = SDL_CreateTexture(
+        new_gui->renderer, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING, GRID_WIDTH, GRID_WIDTH);
+    check_sdl_ptr(new_gui->cells_texture);
+    SDL_SetTextureBlendMode(new_gui->cells_texture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(new_gui->cells_texture, SDL_ScaleModeNearest);
+    // Stamps are never this value, every tile is drawn the first time
+    memset(new_gui->drawn_tile_stamps, 0xff,
+           sizeof(new_gui->drawn_tile_stamps));
+
+    new_gui->density_texture = SDL_CreateTexture(
+        new_gui->renderer, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING, DENSITY_LEVEL_WIDTH(1),
+        DENSITY_LEVEL_WIDTH(1));
+    check_sdl_ptr(new_gui->density_texture);
+    SDL_SetTextureBlendMode(new_gui->density_texture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(new_gui->density_texture, SDL_ScaleModeNearest);
+
     new_gui->running = true;
     new_gui->center_grid = true;
-    new_gui->simulaton_running = false;
     new_gui->restart = false;
     new_gui->drag_grid = false;
     new_gui->shift_pressed = false;
@@ -34,8 +64,14 @@ Gui *gui_alloc() {
     new_gui->current_zoom = 1.f;
     new_gui->view_position.x = 0;
     new_gui->view_position.y = 0;
+    new_gui->speed_index = GUI_SPEEDS - 1;
+    new_gui->rule_index = 0;
 
-    new_gui->gol_state = golstate_alloc();
+    new_gui->simulation = simulation_alloc();
+    if (!new_gui->simulation) {
+        fprintf(stderr, "Error: Could not start the simulation thread\n");
+        exit(1);
+    }
     new_gui->there_is_something_to_draw = true;
 
     SDL_RenderPresent(new_gui->renderer);
@@ -43,7 +79,9 @@ Gui *gui_alloc() {
 }
 
 void gui_destroy(Gui *gui) {
-    golstate_destroy(&gui->gol_state);
+    simulation_destroy(&gui->simulation);
+    SDL_DestroyTexture(gui->cells_texture);
+    SDL_DestroyTexture(gui->density_texture);
     SDL_DestroyWindow(gui->window);
     SDL_DestroyRenderer(gui->renderer);
     SDL_Quit();
@@ -74,6 +112,38 @@ static void gui_handle_zoom(Gui *gui, enum e_zoom e_zoom_flag) {
     }
 }
 
+static void gui_save_pattern(Gui *gui) {
+    const SimulationSnapshot *snapshot =
+        simulation_get_snapshot(gui->simulation);
+    char rule[LIFERULE_TEXT_SIZE];
+    liferule_format(snapshot->rule, rule, sizeof(rule));
+    if (rle_save_file(SAVE_PATH, snapshot->cells, snapshot->len, GRID_WIDTH,
+                      rule))
+        printf("Info: Saved %d cells to %s\n", snapshot->len, SAVE_PATH);
+    else
+        fprintf(stderr, "Error: Could not save to %s\n", SAVE_PATH);
+}
+
+static void gui_change_speed(Gui *gui, int speed_step) {
+    int speed_index = gui->speed_index + speed_step;
+    if (speed_index < 0 || speed_index >= GUI_SPEEDS)
+        return;
+    gui->speed_index = speed_index;
+    simulation_set_speed(gui->simulation, gui_speeds[speed_index]);
+    if (gui_speeds[speed_index] == SIMULATION_UNLIMITED_GPS)
+        puts("Info: Speed unlimited");
+    else
+        printf("Info: Speed %d generations/s\n", gui_speeds[speed_index]);
+}
+
+static void gui_next_rule(Gui *gui) {
+    gui->rule_index = (gui->rule_index + 1) % GUI_RULES;
+    LifeRule rule;
+    liferule_parse(gui_rules[gui->rule_index], &rule);
+    simulation_set_rule(gui->simulation, rule);
+    printf("Info: Rule %s\n", gui_rules[gui->rule_index]);
+}
+
 static void gui_process_key_press_events(Gui *gui, SDL_Event *e) {
     switch (e->key.keysym.sym) {
     case SDLK_ESCAPE:
@@ -106,20 +176,32 @@ static void gui_process_key_press_events(Gui *gui, SDL_Event *e) {
             gui->step_to_next_generation = true;
             puts("Info: Step to the next generation...");
         } else {
-            gui->simulaton_running = !gui->simulaton_running;
+            bool running = !simulation_is_running(gui->simulation);
+            simulation_set_running(gui->simulation, running);
             printf("Info: %s simulation...\n",
-                   gui->simulaton_running ? "Starting" : "Stoping");
+                   running ? "Starting" : "Stoping");
         }
         break;
     case SDLK_r:
         gui->restart = true;
-        gui->simulaton_running = false;
         puts("Info: Restarting...");
         break;
     case SDLK_c:
         gui->center_grid = true;
         puts("Info: Centering grid...");
         break;
+    case SDLK_s:
+        gui_save_pattern(gui);
+        break;
+    case SDLK_b:
+        gui_next_rule(gui);
+        break;
+    case SDLK_LEFTBRACKET:
+        gui_change_speed(gui, -1);
+        break;
+    case SDLK_RIGHTBRACKET:
+        gui_change_speed(gui, 1);
+        break;
     default:
         break;
     }
@@ -136,8 +218,7 @@ static void gui_process_mouse_click_event(Gui *gui, SDL_Event *e) {
             int mouse_in_virtual_grid = gui_point2d_to_grid1d(
                 mouse_position, gui->view_position, GRID_WIDTH, CELL_WIDTH_BASE,
                 gui->current_zoom);
-            golstate_arbitrary_give_birth_cell(gui->gol_state,
-                                               mouse_in_virtual_grid);
+            simulation_give_birth_cell(gui->simulation, mouse_in_virtual_grid);
         } else {
             gui->drag_grid = true;
             gui->initial_mouse_drag_position.x = e->button.x;
@@ -151,7 +232,7 @@ static void gui_process_mouse_click_event(Gui *gui, SDL_Event *e) {
         int mouse_in_virtual_grid = gui_point2d_to_grid1d(
             mouse_position, gui->view_position, GRID_WIDTH, CELL_WIDTH_BASE,
             gui->current_zoom);
-        golstate_arbitrary_kill_cell(gui->gol_state, mouse_in_virtual_grid);
+        simulation_kill_cell(gui->simulation, mouse_in_virtual_grid);
         break;
     case SDL_BUTTON_MIDDLE:
         gui->drag_grid = true;
@@ -165,8 +246,8 @@ static void gui_process_mouse_click_event(Gui *gui, SDL_Event *e) {
 
 static void gui_process_events(Gui *gui) {
     SDL_Event e;
-    gui->there_is_something_to_draw = true;
     while (SDL_PollEvent(&e)) {
+        gui->there_is_something_to_draw = true;
         switch (e.type) {
         case SDL_QUIT:
             gui->running = false;
@@ -196,6 +277,11 @@ static void gui_process_events(Gui *gui) {
                 break;
             }
             break;
+        case SDL_DROPFILE:
+            printf("Info: Loading %s...\n", e.drop.file);
+            simulation_load_rle(gui->simulation, e.drop.file);
+            SDL_free(e.drop.file);
+            break;
         case SDL_MOUSEWHEEL:
             if (e.wheel.y > 0) {
                 gui_handle_zoom(gui, ZOOM_INCREASE);
@@ -215,8 +301,8 @@ static void gui_process_events(Gui *gui) {
                 int mouse_in_virtual_grid = gui_point2d_to_grid1d(
                     mouse_position, gui->view_position, GRID_WIDTH,
                     CELL_WIDTH_BASE, gui->current_zoom);
-                golstate_arbitrary_give_birth_cell(gui->gol_state,
-                                                   mouse_in_virtual_grid);
+                simulation_give_birth_cell(gui->simulation,
+                                           mouse_in_virtual_grid);
             }
             if (gui->right_click_pressed && !gui->shift_pressed) {
                 Point mouse_position;
@@ -225,8 +311,7 @@ static void gui_process_events(Gui *gui) {
                 int mouse_in_virtual_grid = gui_point2d_to_grid1d(
                     mouse_position, gui->view_position, GRID_WIDTH,
                     CELL_WIDTH_BASE, gui->current_zoom);
-                golstate_arbitrary_kill_cell(gui->gol_state,
-                                             mouse_in_virtual_grid);
+                simulation_kill_cell(gui->simulation, mouse_in_virtual_grid);
             }
             break;
         default:
@@ -235,32 +320,27 @@ static void gui_process_events(Gui *gui) {
     }
 }
 
+// Generations are stepped by the simulation thread, the GUI only forwards
+// requests to it
 static void gui_update(Gui *gui) {
     if (gui->restart) {
-        golstate_restart(gui->gol_state);
+        simulation_restart(gui->simulation);
         gui->restart = false;
     }
     if (gui->center_grid) {
         gui_center_grid(gui);
         gui->center_grid = false;
     }
-    if (gui->simulaton_running) {
-        golstate_analyze_generation(gui->gol_state);
-        golstate_next_generation(gui->gol_state);
-        if (gui->gol_state->population == 0) {
-            gui->simulaton_running = false;
-            printf("Info: No population, stoping simulation...\n");
-        }
-    }
     if (gui->step_to_next_generation) {
-        golstate_analyze_generation(gui->gol_state);
-        golstate_next_generation(gui->gol_state);
+        simulation_step(gui->simulation);
         gui->step_to_next_generation = false;
     }
 }
 
 static void gui_draw_grid(Gui *gui) {
     float final_cell_width = CELL_WIDTH_BASE * gui->current_zoom;
+    if (final_cell_width < GRID_LINES_MIN_CELL_WIDTH)
+        return;
     SDL_SetRenderDrawColor(gui->renderer, 20, 20, 20, 255);
 
     float start_x = gui->view_position.x;
@@ -284,57 +364,124 @@ static void gui_draw_grid(Gui *gui) {
     }
 }
 
-static void gui_draw_cell(Gui *gui, Point position) {
-    SDL_Rect rect;
-    float cell_side_f = (float)CELL_WIDTH_BASE * gui->current_zoom;
-    rect.w = rect.h = (float)CELL_WIDTH_BASE * gui->current_zoom;
-    rect.x = (position.x * cell_side_f) + gui->view_position.x;
-    rect.y = (position.y * cell_side_f) + gui->view_position.y;
+static bool gui_lock_texture(SDL_Texture *texture, const SDL_Rect *rect,
+                             void **pixels, int *pitch) {
+    if (SDL_LockTexture(texture, rect, pixels, pitch) == 0)
+        return true;
+    fprintf(stderr, "Error: Could not lock a texture (%s)\n", SDL_GetError());
+    return false;
+}
 
-    if (rect.x > gui->window_width ||
-        rect.x + (CELL_WIDTH_BASE * gui->current_zoom) < 0)
-        return;
-    if (rect.y > gui->window_height ||
-        rect.y + (CELL_WIDTH_BASE * gui->current_zoom) < 0)
+// Rasterizes again the visible tiles whose stamp changed since they were
+// drawn, the dirty tiles of a row are written with a single lock
+static void gui_update_cells_texture(Gui *gui,
+                                     const SimulationSnapshot *snapshot,
+                                     const RasterView *raster_view) {
+    int first_column = raster_view->first_x >> SIMULATION_TILE_SHIFT;
+    int last_column = (raster_view->first_x + raster_view->width - 1) >>
+                      SIMULATION_TILE_SHIFT;
+    int first_row = raster_view->first_y >> SIMULATION_TILE_SHIFT;
+    int last_row = (raster_view->first_y + raster_view->height - 1) >>
+                   SIMULATION_TILE_SHIFT;
+    for (int row = first_row; row <= last_row; row++) {
+        const uint32_t *stamps =
+            snapshot->tile_stamps + row * SIMULATION_TILE_COLUMNS;
+        uint32_t *drawn_stamps =
+            gui->drawn_tile_stamps + row * SIMULATION_TILE_COLUMNS;
+        int first_dirty = -1, last_dirty = -1;
+        for (int column = first_column; column <= last_column; column++) {
+            if (stamps[column] == drawn_stamps[column])
+                continue;
+            if (first_dirty < 0)
+                first_dirty = column;
+            last_dirty = column;
+        }
+        if (first_dirty < 0)
+            continue;
+
+        RasterView dirty_view = {.level = 0};
+        dirty_view.first_x = first_dirty << SIMULATION_TILE_SHIFT;
+        dirty_view.first_y = row << SIMULATION_TILE_SHIFT;
+        dirty_view.width =
+            fmin(GRID_WIDTH, (last_dirty + 1) << SIMULATION_TILE_SHIFT) -
+            dirty_view.first_x;
+        dirty_view.height =
+            fmin(GRID_WIDTH, (row + 1) << SIMULATION_TILE_SHIFT) -
+            dirty_view.first_y;
+        SDL_Rect texture_rect = {dirty_view.first_x, dirty_view.first_y,
+                                 dirty_view.width, dirty_view.height};
+        void *pixels;
+        int pitch;
+        if (!gui_lock_texture(gui->cells_texture, &texture_rect, &pixels,
+                              &pitch))
+            return;
+        raster_cells(snapshot->bitmap, &dirty_view, pixels, pitch);
+        SDL_UnlockTexture(gui->cells_texture);
+        for (int column = first_dirty; column <= last_dirty; column++) {
+            drawn_stamps[column] = stamps[column];
+        }
+    }
+}
+
+// Draws the visible cells with a single copy, the cost depends on the
+// viewport and on what changed, not on the population. When cells are
+// smaller than a pixel the density level matching the zoom is drawn instead.
+static void gui_draw_cells(Gui *gui, const SimulationSnapshot *snapshot) {
+    float cell_width = CELL_WIDTH_BASE * gui->current_zoom;
+    RasterView raster_view;
+    if (!raster_visible_blocks(gui->view_position.x, gui->view_position.y,
+                               cell_width, raster_density_level(cell_width),
+                               gui->window_width, gui->window_height,
+                               &raster_view))
         return;
 
-    SDL_SetRenderDrawColor(gui->renderer, 255, 255, 255, 255);
-    SDL_RenderFillRect(gui->renderer, &rect);
+    SDL_Texture *texture = gui->cells_texture;
+    SDL_Rect texture_rect = {raster_view.first_x, raster_view.first_y,
+                             raster_view.width, raster_view.height};
+    if (raster_view.level == 0) {
+        gui_update_cells_texture(gui, snapshot, &raster_view);
+    } else {
+        texture = gui->density_texture;
+        void *pixels;
+        int pitch;
+        if (!gui_lock_texture(texture, &texture_rect, &pixels, &pitch))
+            return;
+        raster_density(snapshot->density, &raster_view, pixels, pitch);
+        SDL_UnlockTexture(texture);
+    }
+
+    SDL_FRect screen_rect = {raster_view.screen_x, raster_view.screen_y,
+                             raster_view.width * raster_view.block_width,
+                             raster_view.height * raster_view.block_width};
+    SDL_RenderCopyF(gui->renderer, texture, &texture_rect, &screen_rect);
 }
 
 static void gui_render(Gui *gui) {
     SDL_SetRenderDrawColor(gui->renderer, 0, 0, 0, 255);
     SDL_RenderClear(gui->renderer);
     gui_draw_grid(gui);
-
-    Node *current = gui->gol_state->alive_cells;
-    while (current) {
-        Point gui_point =
-            grid1d_to_point2d(current->data, GRID_WIDTH, GRID_SIZE);
-        gui_draw_cell(gui, gui_point);
-        current = current->next;
-    }
+    gui_draw_cells(gui, simulation_get_snapshot(gui->simulation));
 
     SDL_RenderPresent(gui->renderer);
     gui->there_is_something_to_draw = false;
 }
 
 void gui_run(Gui *gui) {
-    uint32_t current_time = SDL_GetTicks();
-    uint32_t last_frame_time = current_time;
     while (gui->running) {
-
-        current_time = SDL_GetTicks();
-        uint32_t elapsed_time = current_time - last_frame_time;
-        if (elapsed_time <= FPS)
-            continue;
+        uint32_t frame_start = SDL_GetTicks();
 
         gui_process_events(gui);
         gui_update(gui);
 
+        // Nothing is drawn while paused and idle
+        if (simulation_has_new_snapshot(gui->simulation))
+            gui->there_is_something_to_draw = true;
         if (gui->there_is_something_to_draw) {
             gui_render(gui);
         }
-        SDL_Delay(10);
+
+        uint32_t elapsed_time = SDL_GetTicks() - frame_start;
+        if (elapsed_time < FRAME_TIME_MS)
+            SDL_Delay(FRAME_TIME_MS - elapsed_time);
     }
 }
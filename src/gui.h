@@ -3,6 +3,7 @@
 
 #include "golstate.h"
 #include "point.h"
+#include "simulation.h"
 
 #include <SDL2/SDL.h>
 
@@ -10,21 +11,33 @@ typedef struct {
     SDL_Window *window;
     int window_width, window_height;
     SDL_Renderer *renderer;
-    bool running, there_is_something_to_draw, simulaton_running, restart,
-        center_grid, shift_pressed, drag_grid, left_click_pressed,
-        step_to_next_generation, right_click_pressed;
+    // One texel per grid cell, kept across frames, only the visible tiles
+    // that changed since they were last drawn are rasterized again
+    SDL_Texture *cells_texture;
+    uint32_t drawn_tile_stamps[SIMULATION_TILES];
+    // One texel per density block, the visible part is rasterized each frame
+    SDL_Texture *density_texture;
+    bool running, there_is_something_to_draw, restart, center_grid,
+        shift_pressed, drag_grid, left_click_pressed, step_to_next_generation,
+        right_click_pressed;
     Point initial_mouse_drag_position;
     float current_zoom;
     Point view_position;
-    GolState *gol_state;
+    // Index in the speeds and rules of gui.c
+    int speed_index, rule_index;
+    Simulation *simulation;
 } Gui;
 
 #define CELL_WIDTH_BASE 15
 #define MAX_ZOOM 2.f
-#define MIN_ZOOM .05f
+#define MIN_ZOOM .005f
 #define FPS 60
+#define FRAME_TIME_MS (1000 / FPS)
 #define ZOOM_STEP .01f
+// Grid lines are not drawn when cells are narrower than this, in pixels
+#define GRID_LINES_MIN_CELL_WIDTH 4
 #define MOVEMENT_STEP 5
+#define SAVE_PATH "agolic.rle"
 
 Gui *gui_alloc();
 void gui_destroy(Gui *gui);
@@ -0,0 +1,523 @@
+#include "hashlife.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HASHLIFE_BLOCK_NODES 4096
+#define HASHLIFE_INITIAL_BUCKETS 4096
+
+struct HashLifeBlock {
+    HashLifeBlock *next;
+    HashLifeNode nodes[HASHLIFE_BLOCK_NODES];
+};
+
+static size_t hashlife_hash(HashLifeNode *nw, HashLifeNode *ne,
+                            HashLifeNode *sw, HashLifeNode *se) {
+    uint64_t hash = (uintptr_t)nw;
+    hash = hash * 0x9e3779b97f4a7c15ull + (uintptr_t)ne;
+    hash = hash * 0x9e3779b97f4a7c15ull + (uintptr_t)sw;
+    hash = hash * 0x9e3779b97f4a7c15ull + (uintptr_t)se;
+    return hash ^ (hash >> 29);
+}
+
+static void hashlife_grow_buckets(HashLife *hash_life) {
+    size_t bucket_count = hash_life->bucket_count * 2;
+    HashLifeNode **buckets = calloc(bucket_count, sizeof(*buckets));
+    if (!buckets)
+        return;
+    for (size_t i = 0; i < hash_life->bucket_count; i++) {
+        HashLifeNode *current = hash_life->buckets[i];
+        while (current) {
+            HashLifeNode *next = current->next_in_bucket;
+            size_t bucket = hashlife_hash(current->nw, current->ne,
+                                          current->sw, current->se) &
+                            (bucket_count - 1);
+            current->next_in_bucket = buckets[bucket];
+            buckets[bucket] = current;
+            current = next;
+        }
+    }
+    free(hash_life->buckets);
+    hash_life->buckets = buckets;
+    hash_life->bucket_count = bucket_count;
+}
+
+static HashLifeNode *hashlife_new_node(HashLife *hash_life) {
+    if (!hash_life->free_nodes) {
+        HashLifeBlock *block = malloc(sizeof(*block));
+        if (!block) {
+            fprintf(stderr, "Error: HashLife out of memory\n");
+            exit(1);
+        }
+        block->next = hash_life->blocks;
+        hash_life->blocks = block;
+        for (int i = HASHLIFE_BLOCK_NODES - 1; i >= 0; i--) {
+            block->nodes[i].next_in_bucket = hash_life->free_nodes;
+            hash_life->free_nodes = &block->nodes[i];
+        }
+    }
+    HashLifeNode *node = hash_life->free_nodes;
+    hash_life->free_nodes = node->next_in_bucket;
+    return node;
+}
+
+// Returns the canonical node with the given quadrants, every node with the
+// same content is the same pointer
+static HashLifeNode *hashlife_find_node(HashLife *hash_life, HashLifeNode *nw,
+                                        HashLifeNode *ne, HashLifeNode *sw,
+                                        HashLifeNode *se) {
+    size_t bucket =
+        hashlife_hash(nw, ne, sw, se) & (hash_life->bucket_count - 1);
+    HashLifeNode *current = hash_life->buckets[bucket];
+    while (current) {
+        if (current->nw == nw && current->ne == ne && current->sw == sw &&
+            current->se == se)
+            return current;
+        current = current->next_in_bucket;
+    }
+
+    HashLifeNode *node = hashlife_new_node(hash_life);
+    node->nw = nw;
+    node->ne = ne;
+    node->sw = sw;
+    node->se = se;
+    node->result = NULL;
+    node->result_step = -1;
+    node->population =
+        nw->population + ne->population + sw->population + se->population;
+    node->level = nw->level + 1;
+    node->marked = false;
+    node->next_in_bucket = hash_life->buckets[bucket];
+    hash_life->buckets[bucket] = node;
+    hash_life->node_count++;
+    if (hash_life->node_count > hash_life->bucket_count)
+        hashlife_grow_buckets(hash_life);
+    return node;
+}
+
+static HashLifeNode *hashlife_empty_node(HashLife *hash_life, int level) {
+    HashLifeNode *node = &hash_life->dead_cell;
+    for (int i = 0; i < level; i++) {
+        node = hashlife_find_node(hash_life, node, node, node, node);
+    }
+    return node;
+}
+
+static void hashlife_init(HashLife *hash_life) {
+    memset(&hash_life->dead_cell, 0, sizeof(hash_life->dead_cell));
+    memset(&hash_life->alive_cell, 0, sizeof(hash_life->alive_cell));
+    hash_life->alive_cell.population = 1;
+    hash_life->buckets = NULL;
+    hash_life->blocks = NULL;
+    hash_life->free_nodes = NULL;
+    hash_life->node_count = 0;
+    hash_life->bucket_count = HASHLIFE_INITIAL_BUCKETS;
+    hash_life->buckets =
+        calloc(hash_life->bucket_count, sizeof(*hash_life->buckets));
+    hash_life->population = 0;
+    hash_life->generation = 0;
+    hash_life->root = NULL;
+    if (hash_life->buckets)
+        hash_life->root = hashlife_empty_node(hash_life, 3);
+}
+
+static void hashlife_release(HashLife *hash_life) {
+    HashLifeBlock *block = hash_life->blocks;
+    while (block) {
+        HashLifeBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(hash_life->buckets);
+    hash_life->blocks = NULL;
+    hash_life->buckets = NULL;
+}
+
+HashLife *hashlife_alloc() {
+    HashLife *hash_life = malloc(sizeof(*hash_life));
+    if (!hash_life)
+        return NULL;
+    hash_life->memory_limit = HASHLIFE_DEFAULT_MEMORY_LIMIT;
+    hashlife_init(hash_life);
+    if (!hash_life->root) {
+        hashlife_release(hash_life);
+        free(hash_life);
+        return NULL;
+    }
+    return hash_life;
+}
+
+void hashlife_destroy(HashLife **hash_life) {
+    hashlife_release(*hash_life);
+    free(*hash_life);
+    *hash_life = NULL;
+}
+
+void hashlife_restart(HashLife *hash_life) {
+    hashlife_release(hash_life);
+    hashlife_init(hash_life);
+}
+
+void hashlife_set_memory_limit(HashLife *hash_life, size_t bytes) {
+    hash_life->memory_limit = bytes;
+}
+
+size_t hashlife_memory_usage(HashLife *hash_life) {
+    return hash_life->node_count * sizeof(HashLifeNode) +
+           hash_life->bucket_count * sizeof(*hash_life->buckets);
+}
+
+// Wraps the root in a node one level up, keeping the origin at the center
+static void hashlife_expand(HashLife *hash_life) {
+    HashLifeNode *root = hash_life->root;
+    HashLifeNode *empty = hashlife_empty_node(hash_life, root->level - 1);
+    HashLifeNode *nw =
+        hashlife_find_node(hash_life, empty, empty, empty, root->nw);
+    HashLifeNode *ne =
+        hashlife_find_node(hash_life, empty, empty, root->ne, empty);
+    HashLifeNode *sw =
+        hashlife_find_node(hash_life, empty, root->sw, empty, empty);
+    HashLifeNode *se =
+        hashlife_find_node(hash_life, root->se, empty, empty, empty);
+    hash_life->root = hashlife_find_node(hash_life, nw, ne, sw, se);
+}
+
+static bool hashlife_root_contains(HashLife *hash_life, int64_t x,
+                                   int64_t y) {
+    int64_t half = (int64_t)1 << (hash_life->root->level - 1);
+    return x >= -half && x < half && y >= -half && y < half;
+}
+
+// x and y are relative to the top left corner of the node
+static HashLifeNode *hashlife_set_cell(HashLife *hash_life, HashLifeNode *node,
+                                       int64_t x, int64_t y, bool alive) {
+    if (node->level == 0)
+        return alive ? &hash_life->alive_cell : &hash_life->dead_cell;
+    int64_t half = (int64_t)1 << (node->level - 1);
+    HashLifeNode *nw = node->nw, *ne = node->ne, *sw = node->sw,
+                 *se = node->se;
+    if (y < half) {
+        if (x < half)
+            nw = hashlife_set_cell(hash_life, nw, x, y, alive);
+        else
+            ne = hashlife_set_cell(hash_life, ne, x - half, y, alive);
+    } else {
+        if (x < half)
+            sw = hashlife_set_cell(hash_life, sw, x, y - half, alive);
+        else
+            se = hashlife_set_cell(hash_life, se, x - half, y - half, alive);
+    }
+    return hashlife_find_node(hash_life, nw, ne, sw, se);
+}
+
+static void hashlife_update_cell(HashLife *hash_life, int64_t x, int64_t y,
+                                 bool alive) {
+    while (!hashlife_root_contains(hash_life, x, y)) {
+        if (hash_life->root->level >= HASHLIFE_MAX_LEVEL)
+            return;
+        hashlife_expand(hash_life);
+    }
+    int64_t half = (int64_t)1 << (hash_life->root->level - 1);
+    hash_life->root = hashlife_set_cell(hash_life, hash_life->root, x + half,
+                                        y + half, alive);
+    hash_life->population = hash_life->root->population;
+}
+
+void hashlife_arbitrary_give_birth_cell(HashLife *hash_life, int64_t x,
+                                        int64_t y) {
+    hashlife_update_cell(hash_life, x, y, true);
+}
+
+void hashlife_arbitrary_kill_cell(HashLife *hash_life, int64_t x, int64_t y) {
+    if (hashlife_root_contains(hash_life, x, y))
+        hashlife_update_cell(hash_life, x, y, false);
+}
+
+bool hashlife_is_cell_alive(HashLife *hash_life, int64_t x, int64_t y) {
+    if (!hashlife_root_contains(hash_life, x, y))
+        return false;
+    HashLifeNode *node = hash_life->root;
+    int64_t half = (int64_t)1 << (node->level - 1);
+    x += half;
+    y += half;
+    while (node->level > 0 && node->population > 0) {
+        half = (int64_t)1 << (node->level - 1);
+        bool east = x >= half, south = y >= half;
+        if (south)
+            node = east ? node->se : node->sw;
+        else
+            node = east ? node->ne : node->nw;
+        x -= east ? half : 0;
+        y -= south ? half : 0;
+    }
+    return node->population > 0;
+}
+
+// Moves the cells whose coordinate on the axis is below limit to the front,
+// returns how many there are
+static int hashlife_partition(GolState *gol_state, int32_t *cells, int count,
+                              bool vertical, int limit) {
+    int front = 0;
+    for (int i = 0; i < count; i++) {
+        int coordinate = vertical ? golstate_cell_y(gol_state, cells[i])
+                                  : golstate_cell_x(gol_state, cells[i]);
+        if (coordinate < limit) {
+            int32_t cell = cells[i];
+            cells[i] = cells[front];
+            cells[front++] = cell;
+        }
+    }
+    return front;
+}
+
+// Builds the node of the given level whose top left corner is the cell
+// (x, y) of the GolState grid out of the live cells it holds, which are
+// split by quadrant on the way down
+static HashLifeNode *hashlife_build_from_cells(HashLife *hash_life,
+                                               GolState *gol_state,
+                                               int32_t *cells, int count,
+                                               int level, int x, int y) {
+    if (count == 0)
+        return hashlife_empty_node(hash_life, level);
+    if (level == 0)
+        return &hash_life->alive_cell;
+    int half = 1 << (level - 1);
+    int north = hashlife_partition(gol_state, cells, count, true, y + half);
+    int nw = hashlife_partition(gol_state, cells, north, false, x + half);
+    int sw = hashlife_partition(gol_state, cells + north, count - north,
+                                false, x + half);
+    int next = level - 1;
+    return hashlife_find_node(
+        hash_life,
+        hashlife_build_from_cells(hash_life, gol_state, cells, nw, next, x, y),
+        hashlife_build_from_cells(hash_life, gol_state, cells + nw,
+                                  north - nw, next, x + half, y),
+        hashlife_build_from_cells(hash_life, gol_state, cells + north, sw,
+                                  next, x, y + half),
+        hashlife_build_from_cells(hash_life, gol_state, cells + north + sw,
+                                  count - north - sw, next, x + half,
+                                  y + half));
+}
+
+// Cells keep the coordinates they have on the GolState grid, column x of the
+// line y becomes the cell (x, y). HashLife only runs B3/S23 on an unbounded
+// universe, GolStates with other rules or a torus are rejected. Only the
+// live cells are read, the cost follows the population and not the grid.
+bool hashlife_load_golstate(HashLife *hash_life, GolState *gol_state) {
+    if (gol_state->rule.transitions != LIFERULE_CONWAY_TRANSITIONS ||
+        gol_state->topology != GOLSTATE_TOPOLOGY_BOUNDED)
+        return false;
+    CellVec *alive_cells = gol_state->alive_cells;
+    int32_t *cells = malloc((alive_cells->len + 1) * sizeof(*cells));
+    if (!cells)
+        return false;
+    if (alive_cells->len)
+        memcpy(cells, alive_cells->data, alive_cells->len * sizeof(*cells));
+    hashlife_restart(hash_life);
+    int level = 1;
+    while ((1 << level) < gol_state->width ||
+           (1 << level) < gol_state->height) {
+        level++;
+    }
+    HashLifeNode *pattern = hashlife_build_from_cells(
+        hash_life, gol_state, cells, alive_cells->len, level, 0, 0);
+    free(cells);
+
+    // The pattern goes into the south east quadrant of a root centered on
+    // the origin
+    HashLifeNode *empty = hashlife_empty_node(hash_life, level);
+    HashLifeNode *se = hashlife_find_node(hash_life, pattern, empty, empty,
+                                          empty);
+    empty = hashlife_empty_node(hash_life, level + 1);
+    hash_life->root = hashlife_find_node(hash_life, empty, empty, empty, se);
+    hash_life->population = hash_life->root->population;
+    hash_life->generation = gol_state->generation;
+    return true;
+}
+
+static HashLifeNode *hashlife_center(HashLife *hash_life, HashLifeNode *node) {
+    return hashlife_find_node(hash_life, node->nw->se, node->ne->sw,
+                              node->sw->ne, node->se->nw);
+}
+
+static HashLifeNode *hashlife_horizontal_center(HashLife *hash_life,
+                                                HashLifeNode *west,
+                                                HashLifeNode *east) {
+    return hashlife_find_node(hash_life, west->ne, east->nw, west->se,
+                              east->sw);
+}
+
+static HashLifeNode *hashlife_vertical_center(HashLife *hash_life,
+                                              HashLifeNode *north,
+                                              HashLifeNode *south) {
+    return hashlife_find_node(hash_life, north->sw, north->se, south->nw,
+                              south->ne);
+}
+
+// One generation of the center 2x2 cells of a level 2 node
+static HashLifeNode *hashlife_level2_result(HashLife *hash_life,
+                                            HashLifeNode *node) {
+    HashLifeNode *quadrants[4] = {node->nw, node->ne, node->sw, node->se};
+    int cells[4][4];
+    for (int q = 0; q < 4; q++) {
+        int x = (q % 2) * 2, y = (q / 2) * 2;
+        cells[y][x] = quadrants[q]->nw->population;
+        cells[y][x + 1] = quadrants[q]->ne->population;
+        cells[y + 1][x] = quadrants[q]->sw->population;
+        cells[y + 1][x + 1] = quadrants[q]->se->population;
+    }
+
+    HashLifeNode *next_cells[4];
+    for (int i = 0; i < 4; i++) {
+        int x = 1 + i % 2, y = 1 + i / 2;
+        int life_in_neighborhood = 0;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx || dy)
+                    life_in_neighborhood += cells[y + dy][x + dx];
+            }
+        }
+        // Memoized results are only valid for B3/S23
+        bool alive = liferule_next_state(LIFERULE_CONWAY_TRANSITIONS,
+                                         cells[y][x], life_in_neighborhood);
+        next_cells[i] = alive ? &hash_life->alive_cell : &hash_life->dead_cell;
+    }
+    return hashlife_find_node(hash_life, next_cells[0], next_cells[1],
+                              next_cells[2], next_cells[3]);
+}
+
+// Center half of the node advanced 2^min(step, level - 2) generations. The
+// nine overlapping sub squares are advanced (or only centered when the step
+// is smaller than the node), regrouped into four, and advanced again.
+static HashLifeNode *hashlife_result(HashLife *hash_life, HashLifeNode *node,
+                                     int step) {
+    int result_step = step < node->level - 2 ? step : node->level - 2;
+    if (node->result && node->result_step == result_step)
+        return node->result;
+
+    HashLifeNode *result;
+    if (node->population == 0) {
+        result = node->nw;
+    } else if (node->level == 2) {
+        result = hashlife_level2_result(hash_life, node);
+    } else {
+        HashLifeNode *squares[9] = {
+            node->nw,
+            hashlife_horizontal_center(hash_life, node->nw, node->ne),
+            node->ne,
+            hashlife_vertical_center(hash_life, node->nw, node->sw),
+            hashlife_center(hash_life, node),
+            hashlife_vertical_center(hash_life, node->ne, node->se),
+            node->sw,
+            hashlife_horizontal_center(hash_life, node->sw, node->se),
+            node->se,
+        };
+        bool full_speed = result_step == node->level - 2;
+        for (int i = 0; i < 9; i++) {
+            squares[i] = full_speed
+                             ? hashlife_result(hash_life, squares[i], step)
+                             : hashlife_center(hash_life, squares[i]);
+        }
+        HashLifeNode *nw = hashlife_find_node(hash_life, squares[0], squares[1],
+                                              squares[3], squares[4]);
+        HashLifeNode *ne = hashlife_find_node(hash_life, squares[1], squares[2],
+                                              squares[4], squares[5]);
+        HashLifeNode *sw = hashlife_find_node(hash_life, squares[3], squares[4],
+                                              squares[6], squares[7]);
+        HashLifeNode *se = hashlife_find_node(hash_life, squares[4], squares[5],
+                                              squares[7], squares[8]);
+        result = hashlife_find_node(hash_life,
+                                    hashlife_result(hash_life, nw, step),
+                                    hashlife_result(hash_life, ne, step),
+                                    hashlife_result(hash_life, sw, step),
+                                    hashlife_result(hash_life, se, step));
+    }
+    node->result = result;
+    node->result_step = result_step;
+    return result;
+}
+
+// True when every live cell is inside the center half of the root
+static bool hashlife_root_is_padded(HashLife *hash_life) {
+    HashLifeNode *root = hash_life->root;
+    if (root->level < 3)
+        return false;
+    return root->nw->population == root->nw->se->population &&
+           root->ne->population == root->ne->sw->population &&
+           root->sw->population == root->sw->ne->population &&
+           root->se->population == root->se->nw->population;
+}
+
+static void hashlife_mark(HashLifeNode *node) {
+    if (node->level == 0 || node->marked)
+        return;
+    node->marked = true;
+    hashlife_mark(node->nw);
+    hashlife_mark(node->ne);
+    hashlife_mark(node->sw);
+    hashlife_mark(node->se);
+}
+
+// Frees every node not reachable from the root. Memoized results of the
+// surviving nodes are kept only when the result node survives too.
+void hashlife_collect_garbage(HashLife *hash_life) {
+    hashlife_mark(hash_life->root);
+    for (size_t i = 0; i < hash_life->bucket_count; i++) {
+        for (HashLifeNode *current = hash_life->buckets[i]; current;
+             current = current->next_in_bucket) {
+            if (current->marked && current->result &&
+                current->result->level > 0 && !current->result->marked) {
+                current->result = NULL;
+                current->result_step = -1;
+            }
+        }
+    }
+    for (size_t i = 0; i < hash_life->bucket_count; i++) {
+        HashLifeNode **link = &hash_life->buckets[i];
+        while (*link) {
+            HashLifeNode *current = *link;
+            if (current->marked) {
+                current->marked = false;
+                link = &current->next_in_bucket;
+                continue;
+            }
+            *link = current->next_in_bucket;
+            current->next_in_bucket = hash_life->free_nodes;
+            hash_life->free_nodes = current;
+            hash_life->node_count--;
+        }
+    }
+}
+
+// Advances 2^step_log2 generations in one call. The root is expanded until
+// the pattern cannot grow out of the result square during the jump. Steps
+// outside [0, HASHLIFE_MAX_STEP_LOG2] are rejected.
+bool hashlife_step(HashLife *hash_life, int step_log2) {
+    if (step_log2 < 0 || step_log2 > HASHLIFE_MAX_STEP_LOG2)
+        return false;
+    if (hashlife_memory_usage(hash_life) > hash_life->memory_limit)
+        hashlife_collect_garbage(hash_life);
+
+    while (hash_life->root->level < step_log2 + 3 ||
+           !hashlife_root_is_padded(hash_life)) {
+        hashlife_expand(hash_life);
+    }
+    hashlife_expand(hash_life);
+    hash_life->root = hashlife_result(hash_life, hash_life->root, step_log2);
+    hash_life->population = hash_life->root->population;
+    hash_life->generation += (uint64_t)1 << step_log2;
+    return true;
+}
+
+// One step per bit of generations, nothing is advanced when it needs a
+// step larger than HASHLIFE_MAX_STEP_LOG2
+bool hashlife_advance(HashLife *hash_life, uint64_t generations) {
+    if (generations >> (HASHLIFE_MAX_STEP_LOG2 + 1))
+        return false;
+    for (int step = 0; generations; step++, generations >>= 1) {
+        if (generations & 1)
+            hashlife_step(hash_life, step);
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef _HASHLIFE_H_
+#define _HASHLIFE_H_
+
+#include "golstate.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The universe is unbounded, the root node of level L covers the cells in
+// [-2^(L-1), 2^(L-1)) on both axes
+#define HASHLIFE_MAX_LEVEL 62
+// Largest jump of one step is 2^HASHLIFE_MAX_STEP_LOG2 generations
+#define HASHLIFE_MAX_STEP_LOG2 (HASHLIFE_MAX_LEVEL - 3)
+#define HASHLIFE_DEFAULT_MEMORY_LIMIT ((size_t)512 * 1024 * 1024)
+
+typedef struct HashLifeNode HashLifeNode;
+struct HashLifeNode {
+    // Quadrants, NULL on the two level 0 nodes (single cells)
+    HashLifeNode *nw, *ne, *sw, *se;
+    // Center half of the node advanced 2^result_step generations
+    HashLifeNode *result;
+    HashLifeNode *next_in_bucket;
+    uint64_t population;
+    int8_t level, result_step;
+    bool marked;
+};
+
+typedef struct HashLifeBlock HashLifeBlock;
+
+typedef struct {
+    HashLifeNode **buckets;
+    size_t bucket_count, node_count;
+    HashLifeBlock *blocks;
+    HashLifeNode *free_nodes;
+    HashLifeNode dead_cell, alive_cell;
+    HashLifeNode *root;
+    size_t memory_limit;
+    uint64_t population, generation;
+} HashLife;
+
+HashLife *hashlife_alloc();
+void hashlife_destroy(HashLife **hash_life);
+void hashlife_restart(HashLife *hash_life);
+void hashlife_set_memory_limit(HashLife *hash_life, size_t bytes);
+size_t hashlife_memory_usage(HashLife *hash_life);
+void hashlife_arbitrary_give_birth_cell(HashLife *hash_life, int64_t x,
+                                        int64_t y);
+void hashlife_arbitrary_kill_cell(HashLife *hash_life, int64_t x, int64_t y);
+bool hashlife_is_cell_alive(HashLife *hash_life, int64_t x, int64_t y);
+bool hashlife_load_golstate(HashLife *hash_life, GolState *gol_state);
+bool hashlife_step(HashLife *hash_life, int step_log2);
+bool hashlife_advance(HashLife *hash_life, uint64_t generations);
+void hashlife_collect_garbage(HashLife *hash_life);
+
+#endif // _HASHLIFE_H_
@@ -0,0 +1,318 @@
+#include "checkpoint.h"
+#include "golstate.h"
+#include "rle.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HEADLESS_DEFAULT_GENERATIONS 1000
+#define HEADLESS_LINE_SIZE 4096
+#define HEADLESS_DEFAULT_CHECKPOINT_SECONDS 300
+
+static void headless_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-g generations] [-r density] [-s seed] "
+            "[-o output.rle] [-k checkpoint.ckpt [-i seconds]] [-R rule] "
+            "[-p period] [-t topology] [-W width] [-H height] "
+            "[pattern.rle|pattern.cells|checkpoint.ckpt]\n"
+            "  -g  generations to advance (default %d)\n"
+            "  -r  fill the grid with random cells, density in (0, 1]\n"
+            "  -s  seed for -r\n"
+            "  -o  save the final cells as RLE\n"
+            "  -k  write a checkpoint periodically and at the end\n"
+            "  -i  seconds between checkpoints (default %d)\n"
+            "  -R  life-like rule in B/S notation, instead of the one of the\n"
+            "      pattern (default B3/S23)\n"
+            "  -p  longest cycle period detected, in [1, %d] (default %d)\n"
+            "  -t  bounded, surrounded by dead cells (default), or torus,\n"
+            "      wrapping around the edges, checkpoints resume with theirs\n"
+            "  -W  grid width, up to %d (default %d)\n"
+            "  -H  grid height (default %d), checkpoints need the defaults\n"
+            "Stops earlier when the population dies or repeats itself.\n",
+            program, HEADLESS_DEFAULT_GENERATIONS,
+            HEADLESS_DEFAULT_CHECKPOINT_SECONDS, GOLSTATE_MAX_CYCLE_PERIOD,
+            GOLSTATE_DEFAULT_CYCLE_PERIOD, GOLSTATE_MAX_WIDTH, GRID_WIDTH,
+            GRID_WIDTH);
+}
+
+// Plaintext pattern, '!' starts a comment line, 'O' or '*' is a live cell.
+// The pattern is centered in the grid.
+static bool headless_load_plaintext(GolState *gol_state, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open \"%s\"\n", path);
+        return false;
+    }
+
+    char line[HEADLESS_LINE_SIZE];
+    int width = 0, height = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '!')
+            continue;
+        int len = strcspn(line, "\r\n");
+        if (len > width)
+            width = len;
+        height++;
+    }
+    if (width > gol_state->width || height > gol_state->height) {
+        fprintf(stderr, "Error: Pattern of %dx%d does not fit the grid\n",
+                width, height);
+        fclose(file);
+        return false;
+    }
+
+    rewind(file);
+    int first_x = (gol_state->width - width) / 2;
+    int y = (gol_state->height - height) / 2;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '!')
+            continue;
+        for (int x = 0; line[x] && line[x] != '\n'; x++) {
+            if (line[x] == 'O' || line[x] == '*')
+                golstate_arbitrary_give_birth_cell(
+                    gol_state, y * gol_state->width + first_x + x);
+        }
+        y++;
+    }
+    fclose(file);
+    return true;
+}
+
+static bool headless_load(GolState *gol_state, const char *path) {
+    const char *extension = strrchr(path, '.');
+    if (extension && strcmp(extension, ".ckpt") == 0) {
+        if (!checkpoint_load_golstate(gol_state, path)) {
+            fprintf(stderr, "Error: Invalid checkpoint \"%s\"\n", path);
+            return false;
+        }
+        printf("Resuming from generation %d\n", gol_state->generation);
+        return true;
+    }
+    if (!extension || strcmp(extension, ".rle") != 0)
+        return headless_load_plaintext(gol_state, path);
+
+    RleHeader header;
+    if (!rle_load_file(gol_state, path, &header)) {
+        fprintf(stderr, "Error: Could not load \"%s\"\n", path);
+        return false;
+    }
+    printf("Pattern: %dx%d, rule %s\n", header.width, header.height,
+           header.rule);
+    LifeRule rule;
+    if (!liferule_parse(header.rule, &rule))
+        fprintf(stderr, "Warning: Unsupported rule \"%s\"\n", header.rule);
+    return true;
+}
+
+static double headless_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void headless_print_stats(GolState *gol_state) {
+    if (!GOLSTATE_STATS_ENABLED)
+        return;
+    GolStateStats stats;
+    GolStateGenerationStats window_total;
+    golstate_get_stats(gol_state, &stats, &window_total);
+    if (stats.window_len == 0)
+        return;
+    printf("Phase times (total ms, last %d generations ms):\n",
+           stats.window_len);
+    for (int phase = 0; phase < GOLSTATE_PHASES; phase++) {
+        printf("  %-18s %10.3f %10.3f\n", golstate_phase_name(phase),
+               stats.total.phase_ns[phase] / 1e6,
+               window_total.phase_ns[phase] / 1e6);
+    }
+    printf("Cells examined: %llu\n",
+           (unsigned long long)stats.total.cells_examined);
+    printf("Births: %llu, deaths: %llu\n",
+           (unsigned long long)stats.total.births,
+           (unsigned long long)stats.total.deaths);
+    printf("Bytes touched: %.3e\n", (double)stats.total.bytes_touched);
+    printf("Cell storage: %zu bytes in %d blocks, %zu live, peak %zu, grown "
+           "in %llu generations\n",
+           stats.storage_bytes, stats.storage_blocks, stats.storage_live_bytes,
+           stats.storage_peak_bytes,
+           (unsigned long long)stats.total.storage_grows);
+}
+
+static void headless_checkpoint(GolState *gol_state, const char *path) {
+    double start = headless_seconds();
+    if (checkpoint_save_golstate(gol_state, path))
+        printf("Checkpoint at generation %d written in %.3fs\n",
+               gol_state->generation, headless_seconds() - start);
+    else
+        fprintf(stderr, "Error: Could not write checkpoint \"%s\"\n", path);
+}
+
+int main(int argc, char **argv) {
+    long generations = HEADLESS_DEFAULT_GENERATIONS;
+    double density = 0;
+    unsigned int seed = time(NULL);
+    const char *output_path = NULL;
+    const char *checkpoint_path = NULL;
+    double checkpoint_seconds = HEADLESS_DEFAULT_CHECKPOINT_SECONDS;
+    const char *rule_text = NULL;
+    LifeRule rule;
+    long max_period = GOLSTATE_DEFAULT_CYCLE_PERIOD;
+    const char *topology_name = NULL;
+    long width = GRID_WIDTH, height = GRID_WIDTH;
+
+    int option;
+    while ((option = getopt(argc, argv, "g:r:s:o:k:i:R:p:t:W:H:h")) != -1) {
+        switch (option) {
+        case 'g':
+            generations = strtol(optarg, NULL, 10);
+            break;
+        case 'r':
+            density = strtod(optarg, NULL);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            output_path = optarg;
+            break;
+        case 'k':
+            checkpoint_path = optarg;
+            break;
+        case 'i':
+            checkpoint_seconds = strtod(optarg, NULL);
+            break;
+        case 'R':
+            rule_text = optarg;
+            break;
+        case 'p':
+            max_period = strtol(optarg, NULL, 10);
+            break;
+        case 't':
+            topology_name = optarg;
+            break;
+        case 'W':
+            width = strtol(optarg, NULL, 10);
+            break;
+        case 'H':
+            height = strtol(optarg, NULL, 10);
+            break;
+        default:
+            headless_usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+    if (generations < 0 || density < 0 || density > 1 ||
+        checkpoint_seconds <= 0 || max_period < 1 ||
+        max_period > GOLSTATE_MAX_CYCLE_PERIOD ||
+        (topology_name && strcmp(topology_name, "bounded") != 0 &&
+         strcmp(topology_name, "torus") != 0) ||
+        (rule_text && !liferule_parse(rule_text, &rule)) ||
+        (optind < argc) == (density > 0) ||
+        width < 1 || width > GOLSTATE_MAX_WIDTH || height < 1 ||
+        height > GOLSTATE_MAX_WIDTH ||
+        (checkpoint_path && (width != GRID_WIDTH || height != GRID_WIDTH))) {
+        headless_usage(argv[0]);
+        return 1;
+    }
+
+    GolState *gol_state = golstate_alloc(width, height);
+    if (!gol_state) {
+        fprintf(stderr, "Error: Could not allocate a %ldx%ld grid\n", width,
+                height);
+        return 1;
+    }
+    GolStateTopology topology = GOLSTATE_TOPOLOGY_BOUNDED;
+    if (topology_name && strcmp(topology_name, "torus") == 0)
+        topology = GOLSTATE_TOPOLOGY_TORUS;
+    golstate_set_topology(gol_state, topology);
+    if (density > 0) {
+        srand(seed);
+        for (int i = 0; i < width * height; i++) {
+            if (rand() < density * RAND_MAX)
+                golstate_arbitrary_give_birth_cell(gol_state, i);
+        }
+    } else if (!headless_load(gol_state, argv[optind])) {
+        golstate_destroy(&gol_state);
+        return 1;
+    }
+    // Checkpoints keep their topology, -t can only confirm it
+    if (topology_name && gol_state->topology != topology) {
+        fprintf(stderr, "Error: The checkpoint was not run on a %s grid\n",
+                topology_name);
+        golstate_destroy(&gol_state);
+        return 1;
+    }
+    if (rule_text)
+        golstate_set_rule(gol_state, rule);
+    golstate_set_cycle_detection(gol_state, max_period);
+    char rule_name[LIFERULE_TEXT_SIZE];
+    liferule_format(gol_state->rule, rule_name, sizeof(rule_name));
+    printf("Rule: %s\n", rule_name);
+    printf("Grid: %ldx%ld, %s\n", width, height,
+           gol_state->topology == GOLSTATE_TOPOLOGY_TORUS ? "torus"
+                                                          : "bounded");
+    printf("Initial population: %d\n", gol_state->population);
+
+    const char *stop_reason = "generation limit";
+    char cycle_reason[64];
+    int first_generation = gol_state->generation;
+    double start = headless_seconds();
+    double last_checkpoint = start;
+    while (gol_state->generation - first_generation < generations) {
+        if (checkpoint_path &&
+            headless_seconds() - last_checkpoint >= checkpoint_seconds) {
+            headless_checkpoint(gol_state, checkpoint_path);
+            last_checkpoint = headless_seconds();
+        }
+        if (gol_state->population == 0) {
+            stop_reason = "no population";
+            break;
+        }
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        int period, cycle_start;
+        if (golstate_get_cycle(gol_state, &period, &cycle_start)) {
+            if (period == 1)
+                snprintf(cycle_reason, sizeof(cycle_reason),
+                         "stable pattern since generation %d", cycle_start);
+            else
+                snprintf(cycle_reason, sizeof(cycle_reason),
+                         "period %d cycle since generation %d", period,
+                         cycle_start);
+            stop_reason = cycle_reason;
+            break;
+        }
+    }
+    double elapsed = headless_seconds() - start;
+
+    int stepped = gol_state->generation - first_generation;
+    double per_second = elapsed > 0 ? stepped / elapsed : 0;
+    printf("Stopped by: %s\n", stop_reason);
+    printf("Generations: %d (now at %d)\n", stepped, gol_state->generation);
+    printf("Final population: %d\n", gol_state->population);
+    printf("Wall time: %.3fs\n", elapsed);
+    printf("Generations/s: %.2f\n", per_second);
+    printf("Cell updates/s: %.3e\n", per_second * width * height);
+    headless_print_stats(gol_state);
+
+    if (checkpoint_path)
+        headless_checkpoint(gol_state, checkpoint_path);
+    if (output_path) {
+        CellVec *grid_indexes = cellvec_alloc();
+        golstate_get_grid_indexes(gol_state, grid_indexes);
+        bool saved = rle_save_file(output_path, grid_indexes->data,
+                                   grid_indexes->len, width, rule_name);
+        cellvec_destroy(&grid_indexes);
+        if (!saved) {
+            fprintf(stderr, "Error: Could not save \"%s\"\n", output_path);
+            golstate_destroy(&gol_state);
+            return 1;
+        }
+    }
+
+    golstate_destroy(&gol_state);
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "liferule.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+LifeRule liferule_conway() {
+    LifeRule rule = {LIFERULE_CONWAY_TRANSITIONS};
+    return rule;
+}
+
+bool liferule_is_conway(LifeRule rule) {
+    return rule.transitions == LIFERULE_CONWAY_TRANSITIONS;
+}
+
+static const char *liferule_parse_counts(const char *text, uint32_t *counts) {
+    while (*text >= '0' && *text < '0' + LIFERULE_COUNTS) {
+        *counts |= 1u << (*text - '0');
+        text++;
+    }
+    return text;
+}
+
+// Accepts "B36/S23" with the parts in any order and any case, and the older
+// "23/36" survive/birth notation. Rules with B0 are rejected, they would
+// give birth to the whole unbounded dead space.
+bool liferule_parse(const char *text, LifeRule *rule) {
+    uint32_t birth = 0, survive = 0;
+    while (isspace((unsigned char)*text))
+        text++;
+
+    char first = toupper((unsigned char)*text);
+    if (first == 'B' || first == 'S') {
+        bool seen_birth = false, seen_survive = false;
+        for (int part = 0; part < 2; part++) {
+            char prefix = toupper((unsigned char)*text);
+            if (prefix == 'B' && !seen_birth) {
+                text = liferule_parse_counts(text + 1, &birth);
+                seen_birth = true;
+            } else if (prefix == 'S' && !seen_survive) {
+                text = liferule_parse_counts(text + 1, &survive);
+                seen_survive = true;
+            } else {
+                return false;
+            }
+            if (part == 0 && *text++ != '/')
+                return false;
+        }
+    } else {
+        text = liferule_parse_counts(text, &survive);
+        if (*text++ != '/')
+            return false;
+        text = liferule_parse_counts(text, &birth);
+    }
+
+    while (isspace((unsigned char)*text))
+        text++;
+    if (*text || birth & 1)
+        return false;
+    rule->transitions = birth | survive << LIFERULE_COUNTS;
+    return true;
+}
+
+// Writes the rule in B/S notation, as "B36/S23"
+void liferule_format(LifeRule rule, char *text, size_t size) {
+    char counts[2][LIFERULE_COUNTS + 1];
+    for (int alive = 0; alive < 2; alive++) {
+        int len = 0;
+        for (int neighbors = 0; neighbors < LIFERULE_COUNTS; neighbors++) {
+            if (liferule_next_state(rule.transitions, alive, neighbors))
+                counts[alive][len++] = '0' + neighbors;
+        }
+        counts[alive][len] = '\0';
+    }
+    snprintf(text, size, "B%s/S%s", counts[0], counts[1]);
+}
@@ -0,0 +1,31 @@
+#ifndef _LIFERULE_H_
+#define _LIFERULE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Outer totalistic rule as an 18 entry lookup mask, the bit
+// alive * LIFERULE_COUNTS + neighbors holds the next state of a cell
+#define LIFERULE_COUNTS 9
+#define LIFERULE_BIRTH(neighbors) (1u << (neighbors))
+#define LIFERULE_SURVIVE(neighbors) (1u << (LIFERULE_COUNTS + (neighbors)))
+#define LIFERULE_CONWAY_TRANSITIONS                                            \
+    (LIFERULE_BIRTH(3) | LIFERULE_SURVIVE(2) | LIFERULE_SURVIVE(3))
+#define LIFERULE_TEXT_SIZE 24
+
+typedef struct {
+    uint32_t transitions;
+} LifeRule;
+
+static inline bool liferule_next_state(uint32_t transitions, bool alive,
+                                       int neighbors) {
+    return (transitions >> (alive * LIFERULE_COUNTS + neighbors)) & 1;
+}
+
+LifeRule liferule_conway();
+bool liferule_is_conway(LifeRule rule);
+bool liferule_parse(const char *text, LifeRule *rule);
+void liferule_format(LifeRule rule, char *text, size_t size);
+
+#endif // _LIFERULE_H_
@@ -0,0 +1,96 @@
+#include "raster.h"
+#include "bitgrid.h"
+
+#include <math.h>
+
+// Coarsest level whose blocks are still no larger than a pixel
+int raster_density_level(float cell_width) {
+    int level = 0;
+    while (level < DENSITY_LEVELS && cell_width * (2 << level) <= 1)
+        level++;
+    return level;
+}
+
+// Returns false when no block of the level is inside the window
+bool raster_visible_blocks(float view_x, float view_y, float cell_width,
+                           int level, int window_width, int window_height,
+                           RasterView *raster_view) {
+    float block_width = cell_width * (1 << level);
+    int level_width = DENSITY_LEVEL_WIDTH(level);
+    int first_x = fmaxf(0, floorf(-view_x / block_width));
+    int first_y = fmaxf(0, floorf(-view_y / block_width));
+    int last_x =
+        fminf(level_width, ceilf((window_width - view_x) / block_width));
+    int last_y =
+        fminf(level_width, ceilf((window_height - view_y) / block_width));
+    if (first_x >= last_x || first_y >= last_y)
+        return false;
+
+    raster_view->level = level;
+    raster_view->first_x = first_x;
+    raster_view->first_y = first_y;
+    raster_view->width = last_x - first_x;
+    raster_view->height = last_y - first_y;
+    raster_view->screen_x = view_x + first_x * block_width;
+    raster_view->screen_y = view_y + first_y * block_width;
+    raster_view->block_width = block_width;
+    return true;
+}
+
+// Writes the visible cells of a BitGrid layout bitmap, pitch is in bytes.
+// Empty words are filled without looking at their bits.
+void raster_cells(const uint64_t *bitmap, const RasterView *raster_view,
+                  uint32_t *pixels, int pitch) {
+    int first_x = raster_view->first_x;
+    int end_x = first_x + raster_view->width;
+    for (int row = 0; row < raster_view->height; row++) {
+        const uint64_t *words =
+            bitmap + (raster_view->first_y + row) * BITGRID_ROW_WORDS;
+        uint32_t *line = (uint32_t *)((uint8_t *)pixels + row * pitch);
+        int x = first_x;
+        while (x < end_x) {
+            int word_end = (x / BITGRID_WORD_BITS + 1) * BITGRID_WORD_BITS;
+            if (word_end > end_x)
+                word_end = end_x;
+            uint64_t word = words[x / BITGRID_WORD_BITS];
+            if (!word) {
+                for (; x < word_end; x++) {
+                    line[x - first_x] = RASTER_DEAD_PIXEL;
+                }
+                continue;
+            }
+            for (; x < word_end; x++) {
+                line[x - first_x] = (word >> (x % BITGRID_WORD_BITS)) & 1
+                                        ? RASTER_ALIVE_PIXEL
+                                        : RASTER_DEAD_PIXEL;
+            }
+        }
+    }
+}
+
+// White with an opacity growing with the count, blocks with any live cell
+// stay visible
+static inline uint32_t raster_density_pixel(int count, int level) {
+    if (!count)
+        return RASTER_DEAD_PIXEL;
+    uint32_t alpha = RASTER_MIN_DENSITY_ALPHA +
+                     (255 - RASTER_MIN_DENSITY_ALPHA) * count /
+                         (1 << (2 * level));
+    return alpha << 24 | (RASTER_ALIVE_PIXEL & 0xffffff);
+}
+
+void raster_density(const DensityPyramid *density,
+                    const RasterView *raster_view, uint32_t *pixels,
+                    int pitch) {
+    int level = raster_view->level;
+    int level_width = DENSITY_LEVEL_WIDTH(level);
+    for (int row = 0; row < raster_view->height; row++) {
+        const uint16_t *counts =
+            density->counts[level] +
+            (raster_view->first_y + row) * level_width + raster_view->first_x;
+        uint32_t *line = (uint32_t *)((uint8_t *)pixels + row * pitch);
+        for (int i = 0; i < raster_view->width; i++) {
+            line[i] = raster_density_pixel(counts[i], level);
+        }
+    }
+}
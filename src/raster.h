@@ -0,0 +1,33 @@
+#ifndef _RASTER_H_
+#define _RASTER_H_
+
+#include "density.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ARGB8888 pixels, dead cells are transparent so the grid lines below them
+// stay visible
+#define RASTER_ALIVE_PIXEL 0xffffffffu
+#define RASTER_DEAD_PIXEL 0x00000000u
+#define RASTER_MIN_DENSITY_ALPHA 64
+
+// Blocks of a density level inside the window, one pixel per block, and
+// where they go on the screen. Level 0 blocks are cells.
+typedef struct {
+    int level;
+    int first_x, first_y, width, height;
+    float screen_x, screen_y, block_width;
+} RasterView;
+
+int raster_density_level(float cell_width);
+bool raster_visible_blocks(float view_x, float view_y, float cell_width,
+                           int level, int window_width, int window_height,
+                           RasterView *raster_view);
+void raster_cells(const uint64_t *bitmap, const RasterView *raster_view,
+                  uint32_t *pixels, int pitch);
+void raster_density(const DensityPyramid *density,
+                    const RasterView *raster_view, uint32_t *pixels,
+                    int pitch);
+
+#endif // _RASTER_H_
@@ -0,0 +1,314 @@
+#include "rle.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    RLE_LINE_START,
+    RLE_COMMENT,
+    RLE_HEADER,
+    RLE_BODY,
+    RLE_DONE
+} RleState;
+
+typedef struct {
+    GolState *gol_state;
+    RleHeader *header;
+    RleState state;
+    bool header_seen;
+    char header_line[RLE_HEADER_SIZE];
+    int header_len;
+    // Pattern position of the next cell and the grid position of (0, 0)
+    int x, y, origin_x, origin_y;
+    int run;
+    int batch[RLE_BATCH_CELLS];
+    int batch_len;
+} RleDecoder;
+
+static void rle_flush_batch(RleDecoder *decoder) {
+    golstate_give_birth_cells(decoder->gol_state, decoder->batch,
+                              decoder->batch_len);
+    decoder->batch_len = 0;
+}
+
+static void rle_place_pattern(RleDecoder *decoder) {
+    RleHeader *header = decoder->header;
+    int width = decoder->gol_state->width;
+    int height = decoder->gol_state->height;
+    decoder->origin_x =
+        header->width < width ? (width - header->width) / 2 : 0;
+    decoder->origin_y =
+        header->height < height ? (height - header->height) / 2 : 0;
+}
+
+static char *rle_trim(char *text) {
+    while (isspace((unsigned char)*text))
+        text++;
+    char *end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1]))
+        *--end = '\0';
+    return text;
+}
+
+// "x = 3, y = 3, rule = B3/S23", unknown fields are ignored
+static bool rle_parse_header(RleDecoder *decoder) {
+    RleHeader *header = decoder->header;
+    decoder->header_line[decoder->header_len] = '\0';
+    char *field = decoder->header_line;
+    while (field) {
+        char *next_field = strchr(field, ',');
+        if (next_field)
+            *next_field++ = '\0';
+        char *value = strchr(field, '=');
+        if (!value)
+            return false;
+        *value++ = '\0';
+        char *key = rle_trim(field);
+        value = rle_trim(value);
+        if (strcmp(key, "x") == 0) {
+            header->width = atoi(value);
+        } else if (strcmp(key, "y") == 0) {
+            header->height = atoi(value);
+        } else if (strcmp(key, "rule") == 0) {
+            strncpy(header->rule, value, RLE_RULE_SIZE - 1);
+            header->rule[RLE_RULE_SIZE - 1] = '\0';
+        }
+        field = next_field;
+    }
+    decoder->header_seen = true;
+    rle_place_pattern(decoder);
+    return header->width >= 0 && header->height >= 0;
+}
+
+static void rle_give_birth_run(RleDecoder *decoder, int count) {
+    GolState *gol_state = decoder->gol_state;
+    int grid_y = decoder->origin_y + decoder->y;
+    for (int i = 0; i < count; i++) {
+        int grid_x = decoder->origin_x + decoder->x + i;
+        if (grid_x >= gol_state->width || grid_y >= gol_state->height)
+            break;
+        decoder->batch[decoder->batch_len++] =
+            grid_y * gol_state->width + grid_x;
+        if (decoder->batch_len == RLE_BATCH_CELLS)
+            rle_flush_batch(decoder);
+    }
+}
+
+// Positions past the end of the grid only drop cells, they stop growing
+// there so long bodies cannot overflow them
+static int rle_advance(int position, int count, int limit) {
+    return count > limit - position ? limit : position + count;
+}
+
+static bool rle_decode_body(RleDecoder *decoder, char c) {
+    // Digits past INT_MAX / 10 are dropped, any such run already crosses the
+    // whole grid and rle_advance stops there
+    if (isdigit((unsigned char)c)) {
+        if (decoder->run < INT_MAX / 10)
+            decoder->run = decoder->run * 10 + (c - '0');
+        return true;
+    }
+    if (isspace((unsigned char)c))
+        return true;
+
+    int count = decoder->run ? decoder->run : 1;
+    int width = decoder->gol_state->width;
+    decoder->run = 0;
+    if (c == 'b' || c == '.') {
+        decoder->x = rle_advance(decoder->x, count, width);
+    } else if (c == 'o' || (c >= 'A' && c <= 'X')) {
+        rle_give_birth_run(decoder, count);
+        decoder->x = rle_advance(decoder->x, count, width);
+    } else if (c == '$') {
+        decoder->y =
+            rle_advance(decoder->y, count, decoder->gol_state->height);
+        decoder->x = 0;
+    } else if (c == '!') {
+        decoder->state = RLE_DONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool rle_decode_chunk(RleDecoder *decoder, const char *chunk,
+                             size_t len) {
+    for (size_t i = 0; i < len && decoder->state != RLE_DONE; i++) {
+        char c = chunk[i];
+        switch (decoder->state) {
+        case RLE_LINE_START:
+            if (c == '#') {
+                decoder->state = RLE_COMMENT;
+            } else if (c == 'x' && !decoder->header_seen) {
+                decoder->state = RLE_HEADER;
+                decoder->header_line[decoder->header_len++] = c;
+            } else if (!isspace((unsigned char)c)) {
+                if (!decoder->header_seen)
+                    rle_place_pattern(decoder);
+                decoder->header_seen = true;
+                decoder->state = RLE_BODY;
+                if (!rle_decode_body(decoder, c))
+                    return false;
+            }
+            break;
+        case RLE_COMMENT:
+            if (c == '\n')
+                decoder->state = RLE_LINE_START;
+            break;
+        case RLE_HEADER:
+            if (c == '\n') {
+                if (!rle_parse_header(decoder))
+                    return false;
+                decoder->state = RLE_LINE_START;
+            } else if (decoder->header_len < RLE_HEADER_SIZE - 1) {
+                decoder->header_line[decoder->header_len++] = c;
+            }
+            break;
+        case RLE_BODY:
+            if (!rle_decode_body(decoder, c))
+                return false;
+            break;
+        case RLE_DONE:
+            break;
+        }
+    }
+    return true;
+}
+
+// The pattern is centered in the grid, cells falling outside are dropped.
+// The rule of the header is applied when it is a supported life-like rule,
+// otherwise the rule of gol_state is kept.
+bool rle_load(GolState *gol_state, FILE *file, RleHeader *header) {
+    RleHeader local_header;
+    if (!header)
+        header = &local_header;
+    header->width = header->height = 0;
+    strcpy(header->rule, RLE_DEFAULT_RULE);
+
+    RleDecoder *decoder = malloc(sizeof(*decoder));
+    char *chunk = malloc(RLE_CHUNK_SIZE);
+    if (!decoder || !chunk) {
+        free(decoder);
+        free(chunk);
+        return false;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->gol_state = gol_state;
+    decoder->header = header;
+    decoder->state = RLE_LINE_START;
+
+    bool ok = true;
+    size_t len;
+    while (ok && decoder->state != RLE_DONE &&
+           (len = fread(chunk, 1, RLE_CHUNK_SIZE, file)) > 0) {
+        ok = rle_decode_chunk(decoder, chunk, len);
+    }
+    if (ok && decoder->state == RLE_HEADER)
+        ok = rle_parse_header(decoder);
+    if (ferror(file))
+        ok = false;
+    rle_flush_batch(decoder);
+    LifeRule rule;
+    if (ok && liferule_parse(header->rule, &rule))
+        golstate_set_rule(gol_state, rule);
+
+    free(chunk);
+    free(decoder);
+    return ok;
+}
+
+bool rle_load_file(GolState *gol_state, const char *path, RleHeader *header) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    bool ok = rle_load(gol_state, file, header);
+    fclose(file);
+    return ok;
+}
+
+typedef struct {
+    FILE *file;
+    int line_len;
+} RleEncoder;
+
+static void rle_write_run(RleEncoder *encoder, int count, char tag) {
+    if (count <= 0)
+        return;
+    char token[16];
+    int token_len = count > 1 ? sprintf(token, "%d%c", count, tag)
+                              : sprintf(token, "%c", tag);
+    if (encoder->line_len + token_len > RLE_LINE_WIDTH) {
+        fputc('\n', encoder->file);
+        encoder->line_len = 0;
+    }
+    fputs(token, encoder->file);
+    encoder->line_len += token_len;
+}
+
+static int rle_compare_cells(const void *a, const void *b) {
+    int32_t cell_a = *(const int32_t *)a, cell_b = *(const int32_t *)b;
+    return (cell_a > cell_b) - (cell_a < cell_b);
+}
+
+// Grid indexes sorted ascending are already in row major order
+bool rle_save(FILE *file, const int32_t *cells, int len, int grid_width,
+              const char *rule) {
+    if (!rule)
+        rule = RLE_DEFAULT_RULE;
+    if (len == 0)
+        return fprintf(file, "x = 0, y = 0, rule = %s\n!\n", rule) > 0;
+
+    int32_t *sorted = malloc(len * sizeof(*sorted));
+    if (!sorted)
+        return false;
+    memcpy(sorted, cells, len * sizeof(*sorted));
+    qsort(sorted, len, sizeof(*sorted), rle_compare_cells);
+
+    int min_x = grid_width, max_x = 0;
+    for (int i = 0; i < len; i++) {
+        int x = sorted[i] % grid_width;
+        if (x < min_x)
+            min_x = x;
+        if (x > max_x)
+            max_x = x;
+    }
+    int min_y = sorted[0] / grid_width, max_y = sorted[len - 1] / grid_width;
+    fprintf(file, "x = %d, y = %d, rule = %s\n", max_x - min_x + 1,
+            max_y - min_y + 1, rule);
+
+    RleEncoder encoder = {file, 0};
+    int x = 0, y = 0, alive_run = 0;
+    for (int i = 0; i < len; i++) {
+        int cell_x = sorted[i] % grid_width - min_x;
+        int cell_y = sorted[i] / grid_width - min_y;
+        if (cell_y > y || cell_x > x) {
+            rle_write_run(&encoder, alive_run, 'o');
+            alive_run = 0;
+        }
+        if (cell_y > y) {
+            rle_write_run(&encoder, cell_y - y, '$');
+            y = cell_y;
+            x = 0;
+        }
+        rle_write_run(&encoder, cell_x - x, 'b');
+        alive_run++;
+        x = cell_x + 1;
+    }
+    rle_write_run(&encoder, alive_run, 'o');
+    rle_write_run(&encoder, 1, '!');
+    fputc('\n', file);
+
+    free(sorted);
+    return !ferror(file);
+}
+
+bool rle_save_file(const char *path, const int32_t *cells, int len,
+                   int grid_width, const char *rule) {
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+    bool ok = rle_save(file, cells, len, grid_width, rule);
+    return fclose(file) == 0 && ok;
+}
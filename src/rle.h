@@ -0,0 +1,32 @@
+#ifndef _RLE_H_
+#define _RLE_H_
+
+#include "golstate.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Files are decoded RLE_CHUNK_SIZE bytes at a time and cells are inserted
+// in batches of RLE_BATCH_CELLS, the pattern is never held whole in memory
+#define RLE_CHUNK_SIZE 65536
+#define RLE_BATCH_CELLS 4096
+#define RLE_HEADER_SIZE 256
+#define RLE_RULE_SIZE 64
+#define RLE_LINE_WIDTH 70
+#define RLE_DEFAULT_RULE "B3/S23"
+
+typedef struct {
+    int width, height;
+    char rule[RLE_RULE_SIZE];
+} RleHeader;
+
+bool rle_load(GolState *gol_state, FILE *file, RleHeader *header);
+bool rle_load_file(GolState *gol_state, const char *path, RleHeader *header);
+// cells are grid indexes of a grid grid_width cells wide
+bool rle_save(FILE *file, const int32_t *cells, int len, int grid_width,
+              const char *rule);
+bool rle_save_file(const char *path, const int32_t *cells, int len,
+                   int grid_width, const char *rule);
+
+#endif // _RLE_H_
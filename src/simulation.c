@@ -0,0 +1,473 @@
+#include "simulation.h"
+#include "rle.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t simulation_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void simulation_record_change(Simulation *simulation, int32_t change) {
+    int cell = change >= 0 ? change : ~change;
+    int tile_x = cell % GRID_WIDTH >> SIMULATION_TILE_SHIFT;
+    int tile_y = cell / GRID_WIDTH >> SIMULATION_TILE_SHIFT;
+    simulation->tile_stamps[tile_y * SIMULATION_TILE_COLUMNS + tile_x] =
+        simulation->publish_sequence;
+    for (int i = 0; i < SIMULATION_SNAPSHOTS; i++) {
+        if (simulation->density_stale[i])
+            continue;
+        if (simulation->density_changes[i]->len >=
+            SIMULATION_MAX_DENSITY_CHANGES) {
+            simulation->density_stale[i] = true;
+            cellvec_clear(simulation->density_changes[i]);
+            continue;
+        }
+        cellvec_push(simulation->density_changes[i], change);
+    }
+}
+
+// Every snapshot rebuilds its pyramid from its cells when published next,
+// and every tile counts as changed
+static void simulation_invalidate_snapshots(Simulation *simulation) {
+    for (int i = 0; i < SIMULATION_SNAPSHOTS; i++) {
+        simulation->density_stale[i] = true;
+        cellvec_clear(simulation->density_changes[i]);
+    }
+    for (int i = 0; i < SIMULATION_TILES; i++) {
+        simulation->tile_stamps[i] = simulation->publish_sequence;
+    }
+}
+
+static void simulation_step_generation(Simulation *simulation) {
+    GolState *gol_state = simulation->gol_state;
+    golstate_analyze_generation(gol_state);
+    CellVec *dying_cells = gol_state->dying_cells;
+    for (int i = 0; i < dying_cells->len; i++) {
+        int cell = dying_cells->data[i];
+        simulation_record_change(simulation,
+                                 ~golstate_grid_index_of(gol_state, cell));
+    }
+    CellVec *becoming_alive_cells = gol_state->becoming_alive_cells;
+    for (int i = 0; i < becoming_alive_cells->len; i++) {
+        simulation_record_change(
+            simulation,
+            golstate_grid_index_of(gol_state, becoming_alive_cells->data[i]));
+    }
+    golstate_next_generation(gol_state);
+}
+
+static void simulation_publish(Simulation *simulation) {
+    GolState *gol_state = simulation->gol_state;
+    SimulationSnapshot *snapshot =
+        &simulation->snapshots[simulation->back_snapshot];
+    // The bitmap still holds the cells of the last time this buffer was
+    // published, clearing only those keeps publishing O(population)
+    for (int i = 0; i < snapshot->len; i++) {
+        int cell = snapshot->cells[i];
+        int x = cell % GRID_WIDTH, y = cell / GRID_WIDTH;
+        snapshot->bitmap[y * BITGRID_ROW_WORDS + x / BITGRID_WORD_BITS] = 0;
+    }
+    int len = gol_state->alive_cells->len;
+    if (len > snapshot->capacity) {
+        int32_t *cells = realloc(snapshot->cells, len * sizeof(*cells));
+        if (!cells) {
+            fprintf(stderr, "Error: Simulation out of memory\n");
+            exit(1);
+        }
+        snapshot->cells = cells;
+        snapshot->capacity = len;
+    }
+    for (int i = 0; i < len; i++) {
+        int cell = gol_state->alive_cells->data[i];
+        int x = golstate_cell_x(gol_state, cell);
+        int y = golstate_cell_y(gol_state, cell);
+        snapshot->cells[i] = y * GRID_WIDTH + x;
+        snapshot->bitmap[y * BITGRID_ROW_WORDS + x / BITGRID_WORD_BITS] |=
+            (uint64_t)1 << (x % BITGRID_WORD_BITS);
+    }
+    snapshot->len = len;
+
+    int back_snapshot = simulation->back_snapshot;
+    CellVec *density_changes = simulation->density_changes[back_snapshot];
+    if (simulation->density_stale[back_snapshot]) {
+        density_rebuild(snapshot->density, snapshot->cells, len);
+        simulation->density_stale[back_snapshot] = false;
+    } else {
+        density_apply_changes(snapshot->density, density_changes->data,
+                              density_changes->len);
+    }
+    cellvec_clear(density_changes);
+    memcpy(snapshot->tile_stamps, simulation->tile_stamps,
+           sizeof(snapshot->tile_stamps));
+    simulation->publish_sequence++;
+
+    snapshot->population = gol_state->population;
+    snapshot->generation = gol_state->generation;
+    snapshot->rule = gol_state->rule;
+
+    int previous =
+        atomic_exchange(&simulation->latest_snapshot,
+                        simulation->back_snapshot | SIMULATION_SNAPSHOT_NEW);
+    simulation->back_snapshot = previous & ~SIMULATION_SNAPSHOT_NEW;
+}
+
+// Called with the lock held, returns whether the live set changed
+static bool simulation_apply_requests(Simulation *simulation) {
+    GolState *gol_state = simulation->gol_state;
+    bool changed = false;
+    if (simulation->pending_restart) {
+        golstate_restart(gol_state);
+        simulation_invalidate_snapshots(simulation);
+        simulation->pending_restart = false;
+        changed = true;
+    }
+
+    if (simulation->pending_rule_change) {
+        golstate_set_rule(gol_state, simulation->pending_rule);
+        simulation->pending_rule_change = false;
+        changed = true;
+    }
+
+    CellVec *pending_edits = simulation->pending_edits;
+    for (int i = 0; i < pending_edits->len; i++) {
+        int32_t edit = pending_edits->data[i];
+        // Only edits flipping a cell are density changes
+        if (golstate_is_cell_alive(gol_state, edit >= 0 ? edit : ~edit) ==
+            (edit >= 0))
+            continue;
+        if (edit >= 0)
+            golstate_arbitrary_give_birth_cell(gol_state, edit);
+        else
+            golstate_arbitrary_kill_cell(gol_state, ~edit);
+        simulation_record_change(simulation, edit);
+        changed = true;
+    }
+    cellvec_clear(pending_edits);
+    return changed;
+}
+
+// Called with the lock held, which is released while the file is read so
+// requests can still be queued
+static void simulation_load_pending(Simulation *simulation) {
+    char *path = simulation->pending_load_path;
+    simulation->pending_load_path = NULL;
+    pthread_mutex_unlock(&simulation->lock);
+
+    golstate_restart(simulation->gol_state);
+    simulation_invalidate_snapshots(simulation);
+    if (!rle_load_file(simulation->gol_state, path, NULL))
+        fprintf(stderr, "Error: Could not load \"%s\"\n", path);
+    free(path);
+    simulation_publish(simulation);
+
+    pthread_mutex_lock(&simulation->lock);
+}
+
+// Called with the lock held, returns how many generations are due now, or
+// -1 when running unlimited. Sets *wake_up_ns when the next one is due later.
+static int simulation_due_generations(Simulation *simulation,
+                                      uint64_t *wake_up_ns) {
+    *wake_up_ns = 0;
+    if (!atomic_load(&simulation->running)) {
+        simulation->clock_started = false;
+        return 0;
+    }
+    if (simulation->target_gps == SIMULATION_UNLIMITED_GPS)
+        return -1;
+
+    uint64_t period_ns = 1000000000 / simulation->target_gps;
+    uint64_t now = simulation_now_ns();
+    if (!simulation->clock_started) {
+        simulation->next_step_ns = now;
+        simulation->clock_started = true;
+    }
+    if (now < simulation->next_step_ns) {
+        *wake_up_ns = simulation->next_step_ns;
+        return 0;
+    }
+    uint64_t lag_ns = now - simulation->next_step_ns;
+    if (lag_ns > SIMULATION_MAX_LAG_NS) {
+        atomic_fetch_add(&simulation->dropped_generations,
+                         (lag_ns - SIMULATION_MAX_LAG_NS) / period_ns);
+        simulation->next_step_ns = now - SIMULATION_MAX_LAG_NS;
+    }
+    return 1 + (now - simulation->next_step_ns) / period_ns;
+}
+
+static void simulation_wait_until(Simulation *simulation, uint64_t time_ns) {
+    struct timespec wake_up = {time_ns / 1000000000, time_ns % 1000000000};
+    pthread_cond_timedwait(&simulation->wake_up, &simulation->lock, &wake_up);
+}
+
+// Steps up to generations (all the batch time when -1), returns how many
+static int simulation_run_batch(Simulation *simulation, int generations) {
+    GolState *gol_state = simulation->gol_state;
+    uint64_t start = simulation_now_ns();
+    int stepped = 0;
+    while (generations < 0 || stepped < generations) {
+        simulation_step_generation(simulation);
+        stepped++;
+        if (gol_state->population == 0) {
+            if (atomic_exchange(&simulation->running, false))
+                printf("Info: No population, stoping simulation...\n");
+            break;
+        }
+        // Only when the cycle is first seen, so it can be resumed
+        int period, cycle_start;
+        if (golstate_get_cycle(gol_state, &period, &cycle_start) &&
+            cycle_start + period == gol_state->generation) {
+            if (atomic_exchange(&simulation->running, false))
+                printf("Info: Period %d cycle since generation %d, stoping "
+                       "simulation...\n",
+                       period, cycle_start);
+            break;
+        }
+        if (simulation_now_ns() - start >= SIMULATION_BATCH_NS)
+            break;
+    }
+    return stepped;
+}
+
+static void *simulation_thread(void *arg) {
+    Simulation *simulation = arg;
+
+    pthread_mutex_lock(&simulation->lock);
+    while (!simulation->quit) {
+        if (simulation->pending_load_path) {
+            simulation_load_pending(simulation);
+            continue;
+        }
+        bool changed = simulation_apply_requests(simulation);
+        uint64_t wake_up_ns;
+        int generations = simulation_due_generations(simulation, &wake_up_ns);
+        if (simulation->pending_step && generations == 0)
+            generations = 1;
+        simulation->pending_step = false;
+        if (!changed && generations == 0) {
+            if (wake_up_ns)
+                simulation_wait_until(simulation, wake_up_ns);
+            else
+                pthread_cond_wait(&simulation->wake_up, &simulation->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&simulation->lock);
+
+        int stepped = 0;
+        if (generations != 0)
+            stepped = simulation_run_batch(simulation, generations);
+        simulation_publish(simulation);
+
+        pthread_mutex_lock(&simulation->lock);
+        if (simulation->clock_started && simulation->target_gps)
+            simulation->next_step_ns +=
+                stepped * (1000000000 / simulation->target_gps);
+    }
+    pthread_mutex_unlock(&simulation->lock);
+    return NULL;
+}
+
+Simulation *simulation_alloc() {
+    Simulation *simulation = malloc(sizeof(*simulation));
+    if (!simulation)
+        return NULL;
+    simulation->gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    simulation->pending_edits = cellvec_alloc();
+    simulation->pending_restart = false;
+    simulation->pending_step = false;
+    simulation->pending_rule_change = false;
+    simulation->quit = false;
+    simulation->target_gps = SIMULATION_UNLIMITED_GPS;
+    simulation->next_step_ns = 0;
+    simulation->clock_started = false;
+    atomic_init(&simulation->dropped_generations, 0);
+    memset(simulation->tile_stamps, 0, sizeof(simulation->tile_stamps));
+    simulation->publish_sequence = 1;
+    simulation->pending_load_path = NULL;
+    atomic_init(&simulation->running, false);
+    bool buffers_allocated =
+        simulation->gol_state && simulation->pending_edits;
+    for (int i = 0; i < SIMULATION_SNAPSHOTS; i++) {
+        simulation->snapshots[i].cells = NULL;
+        simulation->snapshots[i].bitmap =
+            calloc(BITGRID_WORDS, sizeof(*simulation->snapshots[i].bitmap));
+        simulation->snapshots[i].density = density_alloc();
+        simulation->density_changes[i] = cellvec_alloc();
+        simulation->density_stale[i] = false;
+        memset(simulation->snapshots[i].tile_stamps, 0,
+               sizeof(simulation->snapshots[i].tile_stamps));
+        if (!simulation->snapshots[i].bitmap ||
+            !simulation->snapshots[i].density ||
+            !simulation->density_changes[i])
+            buffers_allocated = false;
+        simulation->snapshots[i].len = 0;
+        simulation->snapshots[i].capacity = 0;
+        simulation->snapshots[i].population = 0;
+        simulation->snapshots[i].generation = 0;
+        simulation->snapshots[i].rule = liferule_conway();
+    }
+    simulation->back_snapshot = 0;
+    atomic_init(&simulation->latest_snapshot, 1);
+    simulation->front_snapshot = 2;
+
+    // Timed waits of the fixed timestep use the monotonic clock
+    pthread_condattr_t wake_up_attr;
+    pthread_condattr_init(&wake_up_attr);
+    pthread_condattr_setclock(&wake_up_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&simulation->lock, NULL);
+    pthread_cond_init(&simulation->wake_up, &wake_up_attr);
+    pthread_condattr_destroy(&wake_up_attr);
+    if (!buffers_allocated ||
+        pthread_create(&simulation->thread, NULL, simulation_thread,
+                       simulation) != 0) {
+        pthread_cond_destroy(&simulation->wake_up);
+        pthread_mutex_destroy(&simulation->lock);
+        for (int i = 0; i < SIMULATION_SNAPSHOTS; i++) {
+            free(simulation->snapshots[i].bitmap);
+            if (simulation->snapshots[i].density)
+                density_destroy(&simulation->snapshots[i].density);
+            cellvec_destroy(&simulation->density_changes[i]);
+        }
+        cellvec_destroy(&simulation->pending_edits);
+        golstate_destroy(&simulation->gol_state);
+        free(simulation);
+        return NULL;
+    }
+    return simulation;
+}
+
+void simulation_destroy(Simulation **simulation) {
+    Simulation *s = *simulation;
+    pthread_mutex_lock(&s->lock);
+    s->quit = true;
+    pthread_cond_signal(&s->wake_up);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+
+    pthread_cond_destroy(&s->wake_up);
+    pthread_mutex_destroy(&s->lock);
+    for (int i = 0; i < SIMULATION_SNAPSHOTS; i++) {
+        free(s->snapshots[i].cells);
+        free(s->snapshots[i].bitmap);
+        density_destroy(&s->snapshots[i].density);
+        cellvec_destroy(&s->density_changes[i]);
+    }
+    free(s->pending_load_path);
+    cellvec_destroy(&s->pending_edits);
+    golstate_destroy(&s->gol_state);
+    free(s);
+    *simulation = NULL;
+}
+
+void simulation_set_running(Simulation *simulation, bool running) {
+    pthread_mutex_lock(&simulation->lock);
+    atomic_store(&simulation->running, running);
+    pthread_cond_signal(&simulation->wake_up);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+bool simulation_is_running(Simulation *simulation) {
+    return atomic_load(&simulation->running);
+}
+
+void simulation_step(Simulation *simulation) {
+    pthread_mutex_lock(&simulation->lock);
+    simulation->pending_step = true;
+    pthread_cond_signal(&simulation->wake_up);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+// target_gps is in generations per second, or SIMULATION_UNLIMITED_GPS
+void simulation_set_speed(Simulation *simulation, int target_gps) {
+    if (target_gps < 0)
+        return;
+    pthread_mutex_lock(&simulation->lock);
+    simulation->target_gps = target_gps;
+    simulation->clock_started = false;
+    pthread_cond_signal(&simulation->wake_up);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+int simulation_get_speed(Simulation *simulation) {
+    pthread_mutex_lock(&simulation->lock);
+    int target_gps = simulation->target_gps;
+    pthread_mutex_unlock(&simulation->lock);
+    return target_gps;
+}
+
+// Generations skipped because the simulation fell behind its target speed
+uint64_t simulation_dropped_generations(Simulation *simulation) {
+    return atomic_load(&simulation->dropped_generations);
+}
+
+void simulation_restart(Simulation *simulation) {
+    pthread_mutex_lock(&simulation->lock);
+    atomic_store(&simulation->running, false);
+    simulation->pending_restart = true;
+    cellvec_clear(simulation->pending_edits);
+    pthread_cond_signal(&simulation->wake_up);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+// Applies from the next generation, the cells are kept
+void simulation_set_rule(Simulation *simulation, LifeRule rule) {
+    pthread_mutex_lock(&simulation->lock);
+    simulation->pending_rule = rule;
+    simulation->pending_rule_change = true;
+    pthread_cond_signal(&simulation->wake_up);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+static void simulation_queue_edit(Simulation *simulation, int32_t edit) {
+    pthread_mutex_lock(&simulation->lock);
+    cellvec_push(simulation->pending_edits, edit);
+    pthread_cond_signal(&simulation->wake_up);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+void simulation_give_birth_cell(Simulation *simulation, int grid_index) {
+    if (grid_index < 0 || grid_index >= GRID_SIZE)
+        return;
+    simulation_queue_edit(simulation, grid_index);
+}
+
+void simulation_kill_cell(Simulation *simulation, int grid_index) {
+    if (grid_index < 0 || grid_index >= GRID_SIZE)
+        return;
+    simulation_queue_edit(simulation, ~grid_index);
+}
+
+// Replaces the cells with the pattern, edits queued before are dropped
+void simulation_load_rle(Simulation *simulation, const char *path) {
+    char *path_copy = malloc(strlen(path) + 1);
+    if (!path_copy)
+        return;
+    strcpy(path_copy, path);
+    pthread_mutex_lock(&simulation->lock);
+    atomic_store(&simulation->running, false);
+    free(simulation->pending_load_path);
+    simulation->pending_load_path = path_copy;
+    cellvec_clear(simulation->pending_edits);
+    pthread_cond_signal(&simulation->wake_up);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+// Whether a snapshot was published since the last simulation_get_snapshot()
+bool simulation_has_new_snapshot(Simulation *simulation) {
+    return atomic_load(&simulation->latest_snapshot) & SIMULATION_SNAPSHOT_NEW;
+}
+
+// Only one thread may read snapshots, the returned one stays valid until
+// the next call
+const SimulationSnapshot *simulation_get_snapshot(Simulation *simulation) {
+    if (atomic_load(&simulation->latest_snapshot) & SIMULATION_SNAPSHOT_NEW) {
+        int previous = atomic_exchange(&simulation->latest_snapshot,
+                                       simulation->front_snapshot);
+        simulation->front_snapshot = previous & ~SIMULATION_SNAPSHOT_NEW;
+    }
+    return &simulation->snapshots[simulation->front_snapshot];
+}
@@ -0,0 +1,99 @@
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include "bitgrid.h"
+#include "cellvec.h"
+#include "density.h"
+#include "golstate.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIMULATION_SNAPSHOTS 3
+#define SIMULATION_SNAPSHOT_NEW 0x4
+// Generations per second with no limit
+#define SIMULATION_UNLIMITED_GPS 0
+// Generations stepped before publishing are capped to this much time, and
+// when the simulation falls further behind its target the rest are dropped
+#define SIMULATION_BATCH_NS 16000000
+#define SIMULATION_MAX_LAG_NS 250000000
+// Past this many queued density changes a snapshot rebuilds its pyramid
+#define SIMULATION_MAX_DENSITY_CHANGES (1 << 20)
+// Tiles of 64x64 cells, one bitmap word wide, are stamped with the publish
+// sequence of their last change so readers can redraw only those
+#define SIMULATION_TILE_SHIFT 6
+#define SIMULATION_TILE_WIDTH (1 << SIMULATION_TILE_SHIFT)
+#define SIMULATION_TILE_COLUMNS                                                \
+    ((GRID_WIDTH + SIMULATION_TILE_WIDTH - 1) >> SIMULATION_TILE_SHIFT)
+#define SIMULATION_TILES (SIMULATION_TILE_COLUMNS * SIMULATION_TILE_COLUMNS)
+
+// Copy of the live set published after every generation or edit, it is not
+// modified while the reader holds it. bitmap holds the same cells in the
+// BitGrid layout, BITGRID_WORDS words, and density their counts per block.
+// A tile whose stamp differs from the one of an older snapshot changed since.
+typedef struct {
+    int32_t *cells;
+    uint64_t *bitmap;
+    DensityPyramid *density;
+    uint32_t tile_stamps[SIMULATION_TILES];
+    int len, capacity;
+    int population, generation;
+    LifeRule rule;
+} SimulationSnapshot;
+
+// Steps a GolState on its own thread as fast as it can while running. Other
+// threads only queue requests and read snapshots, the GolState belongs to
+// the simulation thread.
+typedef struct {
+    GolState *gol_state;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake_up;
+    // Births as grid indexes and kills as ~grid_index, in request order
+    CellVec *pending_edits;
+    bool pending_restart, pending_step, pending_rule_change, quit;
+    LifeRule pending_rule;
+    int target_gps;
+    // RLE file replacing the current cells, owned by the simulation
+    char *pending_load_path;
+    atomic_bool running;
+    // Fixed timestep clock while running at a target speed, only used by the
+    // simulation thread
+    uint64_t next_step_ns;
+    bool clock_started;
+    atomic_uint_fast64_t dropped_generations;
+    // Triple buffer, the simulation fills back_snapshot and swaps it with
+    // latest_snapshot, the reader swaps front_snapshot with latest_snapshot
+    // when it is flagged SIMULATION_SNAPSHOT_NEW
+    SimulationSnapshot snapshots[SIMULATION_SNAPSHOTS];
+    atomic_int latest_snapshot;
+    int back_snapshot, front_snapshot;
+    // Births and deaths each snapshot has not seen yet, as in pending_edits,
+    // only used by the simulation thread
+    CellVec *density_changes[SIMULATION_SNAPSHOTS];
+    bool density_stale[SIMULATION_SNAPSHOTS];
+    // Stamps of the snapshot being built, publish_sequence is the stamp of
+    // its changes
+    uint32_t tile_stamps[SIMULATION_TILES];
+    uint32_t publish_sequence;
+} Simulation;
+
+Simulation *simulation_alloc();
+void simulation_destroy(Simulation **simulation);
+void simulation_set_running(Simulation *simulation, bool running);
+bool simulation_is_running(Simulation *simulation);
+void simulation_step(Simulation *simulation);
+void simulation_set_speed(Simulation *simulation, int target_gps);
+int simulation_get_speed(Simulation *simulation);
+uint64_t simulation_dropped_generations(Simulation *simulation);
+bool simulation_has_new_snapshot(Simulation *simulation);
+void simulation_restart(Simulation *simulation);
+void simulation_set_rule(Simulation *simulation, LifeRule rule);
+void simulation_give_birth_cell(Simulation *simulation, int grid_index);
+void simulation_kill_cell(Simulation *simulation, int grid_index);
+void simulation_load_rle(Simulation *simulation, const char *path);
+const SimulationSnapshot *simulation_get_snapshot(Simulation *simulation);
+
+#endif // _SIMULATION_H_
@@ -0,0 +1,465 @@
+#include "tileworld.h"
+#include "bitgrid.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t tileworld_hash(int64_t tile_x, int64_t tile_y) {
+    uint64_t hash = (uint64_t)tile_x * 0x9e3779b97f4a7c15ull;
+    hash ^= (uint64_t)tile_y + 0x7f4a7c159e3779b9ull + (hash << 6) +
+            (hash >> 2);
+    hash ^= hash >> 31;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    return hash ^ (hash >> 29);
+}
+
+static size_t tileworld_home_slot(TileWorld *tile_world, Tile *tile) {
+    return tileworld_hash(tile->tile_x, tile->tile_y) &
+           (tile_world->slot_count - 1);
+}
+
+TileWorld *tileworld_alloc() {
+    TileWorld *tile_world = malloc(sizeof(*tile_world));
+    if (!tile_world)
+        return NULL;
+    tile_world->slot_count = TILEWORLD_INITIAL_SLOTS;
+    tile_world->slots =
+        calloc(tile_world->slot_count, sizeof(*tile_world->slots));
+    if (!tile_world->slots) {
+        free(tile_world);
+        return NULL;
+    }
+    tile_world->tile_count = 0;
+    tile_world->step_tiles = NULL;
+    tile_world->step_tiles_capacity = 0;
+    tile_world->population = 0;
+    tile_world->generation = 0;
+    tile_world->skipped_tiles = 0;
+    tile_world->total_skipped_tiles = 0;
+    return tile_world;
+}
+
+void tileworld_destroy(TileWorld **tile_world) {
+    tileworld_restart(*tile_world);
+    free((*tile_world)->slots);
+    free((*tile_world)->step_tiles);
+    free(*tile_world);
+    *tile_world = NULL;
+}
+
+void tileworld_restart(TileWorld *tile_world) {
+    for (size_t i = 0; i < tile_world->slot_count; i++) {
+        free(tile_world->slots[i]);
+        tile_world->slots[i] = NULL;
+    }
+    tile_world->tile_count = 0;
+    tile_world->population = 0;
+    tile_world->generation = 0;
+    tile_world->skipped_tiles = 0;
+    tile_world->total_skipped_tiles = 0;
+}
+
+size_t tileworld_memory_usage(TileWorld *tile_world) {
+    return sizeof(*tile_world) + tile_world->tile_count * sizeof(Tile) +
+           tile_world->slot_count * sizeof(*tile_world->slots) +
+           tile_world->step_tiles_capacity * sizeof(*tile_world->step_tiles);
+}
+
+Tile *tileworld_get_tile(TileWorld *tile_world, int64_t tile_x,
+                         int64_t tile_y) {
+    size_t mask = tile_world->slot_count - 1;
+    size_t slot = tileworld_hash(tile_x, tile_y) & mask;
+    while (tile_world->slots[slot]) {
+        Tile *tile = tile_world->slots[slot];
+        if (tile->tile_x == tile_x && tile->tile_y == tile_y)
+            return tile;
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+static void tileworld_place_tile(TileWorld *tile_world, Tile *tile) {
+    size_t mask = tile_world->slot_count - 1;
+    size_t slot = tileworld_home_slot(tile_world, tile);
+    while (tile_world->slots[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    tile_world->slots[slot] = tile;
+}
+
+// Keeps the load factor under 1/2 so probe sequences stay short
+static bool tileworld_grow_slots(TileWorld *tile_world) {
+    Tile **old_slots = tile_world->slots;
+    size_t old_slot_count = tile_world->slot_count;
+    Tile **slots = calloc(old_slot_count * 2, sizeof(*slots));
+    if (!slots)
+        return false;
+    tile_world->slots = slots;
+    tile_world->slot_count = old_slot_count * 2;
+    for (size_t i = 0; i < old_slot_count; i++) {
+        if (old_slots[i])
+            tileworld_place_tile(tile_world, old_slots[i]);
+    }
+    free(old_slots);
+    return true;
+}
+
+static Tile *tileworld_create_tile(TileWorld *tile_world, int64_t tile_x,
+                                   int64_t tile_y) {
+    if ((tile_world->tile_count + 1) * 2 > tile_world->slot_count &&
+        !tileworld_grow_slots(tile_world))
+        return NULL;
+    Tile *tile = calloc(1, sizeof(*tile));
+    if (!tile)
+        return NULL;
+    tile->tile_x = tile_x;
+    tile->tile_y = tile_y;
+    tile->rows = tile->buffers[0];
+    tile->previous_rows = tile->buffers[1];
+    tile->next_rows = tile->buffers[2];
+    // Missing tiles have been empty for at least two generations
+    tile->changed = false;
+    tile->changed_two_ago = false;
+    tile->edited = false;
+    tileworld_place_tile(tile_world, tile);
+    tile_world->tile_count++;
+    return tile;
+}
+
+// Backward shift deletion, the following tiles of the probe sequence are
+// moved back so lookups never need tombstones
+static void tileworld_remove_tile(TileWorld *tile_world, Tile *tile) {
+    size_t mask = tile_world->slot_count - 1;
+    size_t hole = tileworld_home_slot(tile_world, tile);
+    while (tile_world->slots[hole] != tile) {
+        hole = (hole + 1) & mask;
+    }
+    tile_world->slots[hole] = NULL;
+
+    size_t slot = hole;
+    while (true) {
+        slot = (slot + 1) & mask;
+        Tile *current = tile_world->slots[slot];
+        if (!current)
+            break;
+        size_t home = tileworld_home_slot(tile_world, current);
+        bool stays = slot > hole ? (home > hole && home <= slot)
+                                 : (home > hole || home <= slot);
+        if (stays)
+            continue;
+        tile_world->slots[hole] = current;
+        tile_world->slots[slot] = NULL;
+        hole = slot;
+    }
+    free(tile);
+    tile_world->tile_count--;
+}
+
+static Tile *tileworld_tile_of(TileWorld *tile_world, int64_t x, int64_t y,
+                               bool create) {
+    int64_t tile_x = x >> TILE_SHIFT, tile_y = y >> TILE_SHIFT;
+    Tile *tile = tileworld_get_tile(tile_world, tile_x, tile_y);
+    if (!tile && create)
+        tile = tileworld_create_tile(tile_world, tile_x, tile_y);
+    return tile;
+}
+
+static uint8_t tileworld_border_of(uint64_t *rows) {
+    uint64_t columns = 0;
+    for (int y = 0; y < TILE_SIZE; y++) {
+        columns |= rows[y];
+    }
+    uint64_t first_row = rows[0], last_row = rows[TILE_MASK];
+    uint64_t west_bit = 1, east_bit = (uint64_t)1 << TILE_MASK;
+    uint8_t border = 0;
+    border |= first_row ? TILE_BORDER_NORTH : 0;
+    border |= last_row ? TILE_BORDER_SOUTH : 0;
+    border |= columns & west_bit ? TILE_BORDER_WEST : 0;
+    border |= columns & east_bit ? TILE_BORDER_EAST : 0;
+    border |= first_row & west_bit ? TILE_BORDER_NORTHWEST : 0;
+    border |= first_row & east_bit ? TILE_BORDER_NORTHEAST : 0;
+    border |= last_row & west_bit ? TILE_BORDER_SOUTHWEST : 0;
+    border |= last_row & east_bit ? TILE_BORDER_SOUTHEAST : 0;
+    return border;
+}
+
+// Edited tiles are computed again, with their neighbors, until their
+// history only holds generations computed from each other
+static void tileworld_mark_edited(Tile *tile, uint8_t border) {
+    tile->border = border;
+    tile->changed = true;
+    tile->changed_two_ago = true;
+    tile->edited = true;
+}
+
+void tileworld_arbitrary_give_birth_cell(TileWorld *tile_world, int64_t x,
+                                         int64_t y) {
+    Tile *tile = tileworld_tile_of(tile_world, x, y, true);
+    if (!tile)
+        return;
+    uint64_t bit = (uint64_t)1 << (x & TILE_MASK);
+    if (tile->rows[y & TILE_MASK] & bit)
+        return;
+    tile->rows[y & TILE_MASK] |= bit;
+    tile->population++;
+    tile_world->population++;
+
+    uint8_t border = 0;
+    int column = x & TILE_MASK, row = y & TILE_MASK;
+    border |= row == 0 ? TILE_BORDER_NORTH : 0;
+    border |= row == TILE_MASK ? TILE_BORDER_SOUTH : 0;
+    border |= column == 0 ? TILE_BORDER_WEST : 0;
+    border |= column == TILE_MASK ? TILE_BORDER_EAST : 0;
+    if ((border & TILE_BORDER_NORTH) && (border & TILE_BORDER_WEST))
+        border |= TILE_BORDER_NORTHWEST;
+    if ((border & TILE_BORDER_NORTH) && (border & TILE_BORDER_EAST))
+        border |= TILE_BORDER_NORTHEAST;
+    if ((border & TILE_BORDER_SOUTH) && (border & TILE_BORDER_WEST))
+        border |= TILE_BORDER_SOUTHWEST;
+    if ((border & TILE_BORDER_SOUTH) && (border & TILE_BORDER_EAST))
+        border |= TILE_BORDER_SOUTHEAST;
+    tileworld_mark_edited(tile, tile->border | border);
+}
+
+void tileworld_arbitrary_kill_cell(TileWorld *tile_world, int64_t x,
+                                   int64_t y) {
+    Tile *tile = tileworld_tile_of(tile_world, x, y, false);
+    if (!tile)
+        return;
+    uint64_t bit = (uint64_t)1 << (x & TILE_MASK);
+    if (!(tile->rows[y & TILE_MASK] & bit))
+        return;
+    tile->rows[y & TILE_MASK] &= ~bit;
+    tile->population--;
+    tile_world->population--;
+    tileworld_mark_edited(tile, tileworld_border_of(tile->rows));
+}
+
+bool tileworld_is_cell_alive(TileWorld *tile_world, int64_t x, int64_t y) {
+    Tile *tile = tileworld_tile_of(tile_world, x, y, false);
+    if (!tile)
+        return false;
+    return tile->rows[y & TILE_MASK] & ((uint64_t)1 << (x & TILE_MASK));
+}
+
+// TileWorld only runs B3/S23 on an unbounded universe, GolStates with other
+// rules or a torus are rejected
+bool tileworld_load_golstate(TileWorld *tile_world, GolState *gol_state) {
+    if (gol_state->rule.transitions != LIFERULE_CONWAY_TRANSITIONS ||
+        gol_state->topology != GOLSTATE_TOPOLOGY_BOUNDED)
+        return false;
+    tileworld_restart(tile_world);
+    CellVec *alive_cells = gol_state->alive_cells;
+    for (int i = 0; i < alive_cells->len; i++) {
+        tileworld_arbitrary_give_birth_cell(
+            tile_world, golstate_cell_x(gol_state, alive_cells->data[i]),
+            golstate_cell_y(gol_state, alive_cells->data[i]));
+    }
+    tile_world->generation = gol_state->generation;
+    return true;
+}
+
+static bool tileworld_push_step_tile(TileWorld *tile_world, size_t *count,
+                                     Tile *tile) {
+    if (*count == tile_world->step_tiles_capacity) {
+        size_t capacity = tile_world->step_tiles_capacity
+                              ? tile_world->step_tiles_capacity * 2
+                              : TILEWORLD_INITIAL_SLOTS;
+        Tile **step_tiles =
+            realloc(tile_world->step_tiles, capacity * sizeof(*step_tiles));
+        if (!step_tiles)
+            return false;
+        tile_world->step_tiles = step_tiles;
+        tile_world->step_tiles_capacity = capacity;
+    }
+    tile_world->step_tiles[(*count)++] = tile;
+    return true;
+}
+
+static void tileworld_ensure_tile(TileWorld *tile_world, size_t *count,
+                                  int64_t tile_x, int64_t tile_y) {
+    if (tileworld_get_tile(tile_world, tile_x, tile_y))
+        return;
+    Tile *tile = tileworld_create_tile(tile_world, tile_x, tile_y);
+    if (tile && !tileworld_push_step_tile(tile_world, count, tile))
+        tileworld_remove_tile(tile_world, tile);
+}
+
+// Cells on the border of a tile can give birth in the neighbor tile
+static void tileworld_spawn_neighbors(TileWorld *tile_world, size_t *count,
+                                      Tile *tile) {
+    uint8_t border = tile->border;
+    int64_t x = tile->tile_x, y = tile->tile_y;
+    if (!border)
+        return;
+    if (border & TILE_BORDER_NORTH)
+        tileworld_ensure_tile(tile_world, count, x, y - 1);
+    if (border & TILE_BORDER_SOUTH)
+        tileworld_ensure_tile(tile_world, count, x, y + 1);
+    if (border & TILE_BORDER_WEST)
+        tileworld_ensure_tile(tile_world, count, x - 1, y);
+    if (border & TILE_BORDER_EAST)
+        tileworld_ensure_tile(tile_world, count, x + 1, y);
+    if (border & TILE_BORDER_NORTHWEST)
+        tileworld_ensure_tile(tile_world, count, x - 1, y - 1);
+    if (border & TILE_BORDER_NORTHEAST)
+        tileworld_ensure_tile(tile_world, count, x + 1, y - 1);
+    if (border & TILE_BORDER_SOUTHWEST)
+        tileworld_ensure_tile(tile_world, count, x - 1, y + 1);
+    if (border & TILE_BORDER_SOUTHEAST)
+        tileworld_ensure_tile(tile_world, count, x + 1, y + 1);
+}
+
+static uint64_t tileworld_row_or_empty(Tile *tile, int row) {
+    return tile ? tile->rows[row] : 0;
+}
+
+// Neighbors of a tile, in the order of the rows of a 3x3 block without its
+// center: northwest, north, northeast, west, east, southwest, south and
+// southeast
+#define TILE_NEIGHBORS 8
+
+static void tileworld_get_neighbors(TileWorld *tile_world, Tile *tile,
+                                    Tile *neighbors[TILE_NEIGHBORS]) {
+    int n = 0;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            if (dx || dy)
+                neighbors[n++] = tileworld_get_tile(
+                    tile_world, tile->tile_x + dx, tile->tile_y + dy);
+        }
+    }
+}
+
+// A tile whose whole neighborhood is the same as one generation ago stays
+// as it is, when it is the same as two generations ago the tile goes back to
+// its previous generation. Missing tiles have been empty for longer.
+static TileStep tileworld_choose_step(Tile *tile,
+                                      Tile *neighbors[TILE_NEIGHBORS]) {
+    bool still = !tile->changed, period2 = !tile->changed_two_ago;
+    for (int i = 0; i < TILE_NEIGHBORS && (still || period2); i++) {
+        if (!neighbors[i])
+            continue;
+        still = still && !neighbors[i]->changed;
+        period2 = period2 && !neighbors[i]->changed_two_ago;
+    }
+    if (still)
+        return TILE_STEP_STILL;
+    if (period2)
+        return TILE_STEP_PERIOD2;
+    return TILE_STEP_COMPUTE;
+}
+
+// Same adder network as the BitGrid kernel, the west and east words come
+// from the neighbor tiles and the rows -1 and TILE_SIZE from the tiles above
+// and below
+static void tileworld_next_tile(Tile *tile, Tile *neighbors[TILE_NEIGHBORS]) {
+    Tile *north = neighbors[1], *west_tile = neighbors[3],
+         *east_tile = neighbors[4], *south = neighbors[6];
+
+    uint64_t west[TILE_SIZE + 2], center[TILE_SIZE + 2], east[TILE_SIZE + 2];
+    west[0] = tileworld_row_or_empty(neighbors[0], TILE_MASK);
+    center[0] = tileworld_row_or_empty(north, TILE_MASK);
+    east[0] = tileworld_row_or_empty(neighbors[2], TILE_MASK);
+    for (int row = 0; row < TILE_SIZE; row++) {
+        west[row + 1] = tileworld_row_or_empty(west_tile, row);
+        center[row + 1] = tile->rows[row];
+        east[row + 1] = tileworld_row_or_empty(east_tile, row);
+    }
+    west[TILE_SIZE + 1] = tileworld_row_or_empty(neighbors[5], 0);
+    center[TILE_SIZE + 1] = tileworld_row_or_empty(south, 0);
+    east[TILE_SIZE + 1] = tileworld_row_or_empty(neighbors[7], 0);
+
+    int population = 0;
+    for (int row = 0; row < TILE_SIZE; row++) {
+        uint64_t v0 = center[row] ^ center[row + 2];
+        uint64_t v1 = center[row] & center[row + 2];
+        uint64_t word = bitgrid_next_word(
+            bitgrid_west(v0, west[row] ^ west[row + 2]), v0,
+            bitgrid_east(v0, east[row] ^ east[row + 2]),
+            bitgrid_west(v1, west[row] & west[row + 2]), v1,
+            bitgrid_east(v1, east[row] & east[row + 2]),
+            bitgrid_west(center[row + 1], west[row + 1]), center[row + 1],
+            bitgrid_east(center[row + 1], east[row + 1]));
+        tile->next_rows[row] = word;
+        population += __builtin_popcountll(word);
+    }
+    tile->next_population = population;
+}
+
+static void tileworld_commit_tile(Tile *tile) {
+    uint64_t *swap;
+    int population;
+    uint8_t border;
+    switch (tile->step) {
+    case TILE_STEP_STILL:
+        tile->changed_two_ago = false;
+        break;
+    case TILE_STEP_PERIOD2:
+        swap = tile->rows;
+        tile->rows = tile->previous_rows;
+        tile->previous_rows = swap;
+        population = tile->population;
+        tile->population = tile->previous_population;
+        tile->previous_population = population;
+        border = tile->border;
+        tile->border = tile->previous_border;
+        tile->previous_border = border;
+        tile->changed_two_ago = false;
+        break;
+    case TILE_STEP_COMPUTE:
+        tile->changed = memcmp(tile->next_rows, tile->rows,
+                               TILE_SIZE * sizeof(*tile->rows)) != 0;
+        tile->changed_two_ago =
+            tile->edited || memcmp(tile->next_rows, tile->previous_rows,
+                                   TILE_SIZE * sizeof(*tile->rows)) != 0;
+        swap = tile->previous_rows;
+        tile->previous_rows = tile->rows;
+        tile->rows = tile->next_rows;
+        tile->next_rows = swap;
+        tile->previous_population = tile->population;
+        tile->population = tile->next_population;
+        tile->previous_border = tile->border;
+        tile->border = tileworld_border_of(tile->rows);
+        break;
+    }
+    tile->edited = false;
+}
+
+void tileworld_next_generation(TileWorld *tile_world) {
+    size_t count = 0;
+    for (size_t i = 0; i < tile_world->slot_count; i++) {
+        if (tile_world->slots[i])
+            tileworld_push_step_tile(tile_world, &count, tile_world->slots[i]);
+    }
+    size_t live_tiles = count;
+    for (size_t i = 0; i < live_tiles; i++) {
+        tileworld_spawn_neighbors(tile_world, &count,
+                                  tile_world->step_tiles[i]);
+    }
+
+    size_t skipped_tiles = 0;
+    for (size_t i = 0; i < count; i++) {
+        Tile *tile = tile_world->step_tiles[i];
+        Tile *neighbors[TILE_NEIGHBORS];
+        tileworld_get_neighbors(tile_world, tile, neighbors);
+        tile->step = tileworld_choose_step(tile, neighbors);
+        if (tile->step == TILE_STEP_COMPUTE)
+            tileworld_next_tile(tile, neighbors);
+        else
+            skipped_tiles++;
+    }
+
+    int64_t population = 0;
+    for (size_t i = 0; i < count; i++) {
+        Tile *tile = tile_world->step_tiles[i];
+        tileworld_commit_tile(tile);
+        population += tile->population;
+        if (tile->population == 0 && !tile->changed && !tile->changed_two_ago)
+            tileworld_remove_tile(tile_world, tile);
+    }
+    tile_world->population = population;
+    tile_world->generation++;
+    tile_world->skipped_tiles = skipped_tiles;
+    tile_world->total_skipped_tiles += skipped_tiles;
+}
@@ -0,0 +1,79 @@
+#ifndef _TILEWORLD_H_
+#define _TILEWORLD_H_
+
+#include "golstate.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The world is unbounded, the cell (x, y) lives in the tile
+// (x >> TILE_SHIFT, y >> TILE_SHIFT) as the bit x & TILE_MASK of the row
+// y & TILE_MASK
+#define TILE_SHIFT 6
+#define TILE_SIZE (1 << TILE_SHIFT)
+#define TILE_MASK (TILE_SIZE - 1)
+#define TILEWORLD_INITIAL_SLOTS 64
+
+// Sides of a tile holding live cells
+#define TILE_BORDER_NORTH 0x01
+#define TILE_BORDER_SOUTH 0x02
+#define TILE_BORDER_WEST 0x04
+#define TILE_BORDER_EAST 0x08
+#define TILE_BORDER_NORTHWEST 0x10
+#define TILE_BORDER_NORTHEAST 0x20
+#define TILE_BORDER_SOUTHWEST 0x40
+#define TILE_BORDER_SOUTHEAST 0x80
+
+typedef enum {
+    TILE_STEP_COMPUTE,
+    TILE_STEP_STILL,
+    TILE_STEP_PERIOD2
+} TileStep;
+
+typedef struct {
+    int64_t tile_x, tile_y;
+    // Current generation, the one before it and the one being computed,
+    // rotated over buffers
+    uint64_t *rows, *previous_rows, *next_rows;
+    uint64_t buffers[3][TILE_SIZE];
+    int population, previous_population, next_population;
+    uint8_t border, previous_border;
+    // rows differ from the generation before / from two generations before
+    bool changed, changed_two_ago;
+    // Cells were edited by hand, the generation two ago is not a predecessor
+    bool edited;
+    TileStep step;
+} Tile;
+
+// Open addressing hash map of tiles with linear probing, tiles are created
+// on demand when cells are born next to them and freed once they have been
+// empty for three generations. Tiles that did not change in the last one or
+// two generations, and whose neighbors did not either, are not computed.
+typedef struct {
+    Tile **slots;
+    size_t slot_count, tile_count;
+    Tile **step_tiles;
+    size_t step_tiles_capacity;
+    int64_t population;
+    uint64_t generation;
+    // Tiles whose neighborhood was still or period 2 and were not computed
+    size_t skipped_tiles;
+    uint64_t total_skipped_tiles;
+} TileWorld;
+
+TileWorld *tileworld_alloc();
+void tileworld_destroy(TileWorld **tile_world);
+void tileworld_restart(TileWorld *tile_world);
+size_t tileworld_memory_usage(TileWorld *tile_world);
+Tile *tileworld_get_tile(TileWorld *tile_world, int64_t tile_x,
+                         int64_t tile_y);
+void tileworld_arbitrary_give_birth_cell(TileWorld *tile_world, int64_t x,
+                                         int64_t y);
+void tileworld_arbitrary_kill_cell(TileWorld *tile_world, int64_t x,
+                                   int64_t y);
+bool tileworld_is_cell_alive(TileWorld *tile_world, int64_t x, int64_t y);
+bool tileworld_load_golstate(TileWorld *tile_world, GolState *gol_state);
+void tileworld_next_generation(TileWorld *tile_world);
+
+#endif // _TILEWORLD_H_
@@ -0,0 +1,160 @@
+#include "../src/bitgrid.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+#include <time.h>
+
+static inline int random_betewen(int lower, int upper) {
+    return (rand() % (upper - lower + 1)) + lower;
+}
+
+void init_seed() { srand(time(NULL)); }
+
+TestSuite(bitgrid, .init = init_seed);
+
+Test(bitgrid, bitgrid_alloc) {
+    BitGrid *bit_grid = bitgrid_alloc();
+    cr_assert_not_null(bit_grid, "bitgrid_alloc() returned NULL");
+    cr_assert_eq(bit_grid->population, 0);
+    bitgrid_destroy(&bit_grid);
+    cr_assert_null(bit_grid, "bitgrid_destroy() returned not NULL");
+}
+
+Test(bitgrid, give_birth_and_kill) {
+    BitGrid *bit_grid = bitgrid_alloc();
+
+    bitgrid_arbitrary_give_birth_cell(bit_grid, 63);
+    bitgrid_arbitrary_give_birth_cell(bit_grid, 64);
+    bitgrid_arbitrary_give_birth_cell(bit_grid, 64);
+    bitgrid_arbitrary_give_birth_cell(bit_grid, GRID_SIZE - 1);
+    bitgrid_arbitrary_give_birth_cell(bit_grid, GRID_SIZE);
+    cr_assert_eq(bit_grid->population, 3);
+    cr_assert(bitgrid_is_cell_alive(bit_grid, 63));
+    cr_assert(bitgrid_is_cell_alive(bit_grid, 64));
+    cr_assert(bitgrid_is_cell_alive(bit_grid, GRID_SIZE - 1));
+    cr_assert_not(bitgrid_is_cell_alive(bit_grid, 65));
+
+    bitgrid_arbitrary_kill_cell(bit_grid, 64);
+    bitgrid_arbitrary_kill_cell(bit_grid, 65);
+    cr_assert_eq(bit_grid->population, 2);
+    cr_assert_not(bitgrid_is_cell_alive(bit_grid, 64));
+
+    bitgrid_restart(bit_grid);
+    cr_assert_eq(bit_grid->population, 0);
+    cr_assert_not(bitgrid_is_cell_alive(bit_grid, 63));
+
+    bitgrid_destroy(&bit_grid);
+}
+
+Test(bitgrid, grid_limits) {
+    BitGrid *bit_grid = bitgrid_alloc();
+
+    // Blinkers clipped by each corner lose one cell
+    int corners[] = {0, GRID_WIDTH - 3, GRID_SIZE - GRID_WIDTH,
+                     GRID_SIZE - 3};
+    for (int i = 0; i < 4; i++) {
+        bitgrid_restart(bit_grid);
+        bitgrid_arbitrary_give_birth_cell(bit_grid, corners[i]);
+        bitgrid_arbitrary_give_birth_cell(bit_grid, corners[i] + 1);
+        bitgrid_arbitrary_give_birth_cell(bit_grid, corners[i] + 2);
+        bitgrid_next_generation(bit_grid);
+        cr_expect_eq(bit_grid->population, 2,
+                     "Corner %d population should be 2 instead of %d", i,
+                     bit_grid->population);
+    }
+
+    bitgrid_destroy(&bit_grid);
+}
+
+Test(bitgrid, matches_golstate) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    BitGrid *bit_grid = bitgrid_alloc();
+
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+        bitgrid_arbitrary_give_birth_cell(bit_grid, i);
+    }
+
+    for (int generation = 0; generation < 5; generation++) {
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        bitgrid_next_generation(bit_grid);
+        cr_assert_eq(bit_grid->population, gol_state->population,
+                     "Generation %d: population %d, expected %d", generation,
+                     bit_grid->population, gol_state->population);
+        for (int i = 0; i < GRID_SIZE; i++) {
+            cr_assert_eq(bitgrid_is_cell_alive(bit_grid, i),
+                         golstate_is_cell_alive(gol_state, i),
+                         "Generation %d: cell %d differs from GolState",
+                         generation, i);
+        }
+    }
+
+    golstate_destroy(&gol_state);
+    bitgrid_destroy(&bit_grid);
+}
+
+Test(bitgrid, kernels_match_scalar) {
+    BitGridKernel selected = bitgrid_get_kernel();
+    BitGridKernel kernels[] = {BITGRID_KERNEL_SSE2, BITGRID_KERNEL_AVX2};
+
+    for (int k = 0; k < 2; k++) {
+        if (!bitgrid_kernel_is_supported(kernels[k]))
+            continue;
+        BitGrid *reference = bitgrid_alloc();
+        BitGrid *bit_grid = bitgrid_alloc();
+        for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+            bitgrid_arbitrary_give_birth_cell(reference, i);
+            bitgrid_arbitrary_give_birth_cell(bit_grid, i);
+        }
+
+        for (int generation = 0; generation < 5; generation++) {
+            bitgrid_set_kernel(BITGRID_KERNEL_SCALAR);
+            bitgrid_next_generation(reference);
+            bitgrid_set_kernel(kernels[k]);
+            bitgrid_next_generation(bit_grid);
+            cr_assert_eq(bit_grid->population, reference->population,
+                         "Kernel %s: population %d, expected %d",
+                         bitgrid_kernel_name(kernels[k]),
+                         bit_grid->population, reference->population);
+            cr_assert_arr_eq(bit_grid->cells, reference->cells,
+                             BITGRID_WORDS * sizeof(*bit_grid->cells),
+                             "Kernel %s differs from the scalar kernel",
+                             bitgrid_kernel_name(kernels[k]));
+        }
+
+        bitgrid_destroy(&reference);
+        bitgrid_destroy(&bit_grid);
+    }
+    bitgrid_set_kernel(selected);
+}
+
+Test(bitgrid, threads_match_single_thread) {
+    BitGrid *reference = bitgrid_alloc();
+    BitGrid *bit_grid = bitgrid_alloc();
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        bitgrid_arbitrary_give_birth_cell(reference, i);
+        bitgrid_arbitrary_give_birth_cell(bit_grid, i);
+    }
+
+    int thread_counts[] = {3, 8, 1, 4};
+    for (int t = 0; t < 4; t++) {
+        cr_assert(bitgrid_set_threads(bit_grid, thread_counts[t]),
+                  "bitgrid_set_threads(%d) failed", thread_counts[t]);
+        cr_assert_eq(bit_grid->thread_count, thread_counts[t]);
+        for (int generation = 0; generation < 3; generation++) {
+            bitgrid_next_generation(reference);
+            bitgrid_next_generation(bit_grid);
+            cr_assert_eq(bit_grid->population, reference->population,
+                         "%d threads: population %d, expected %d",
+                         thread_counts[t], bit_grid->population,
+                         reference->population);
+            cr_assert_arr_eq(bit_grid->cells, reference->cells,
+                             BITGRID_WORDS * sizeof(*bit_grid->cells),
+                             "%d threads: grid differs from single thread",
+                             thread_counts[t]);
+        }
+    }
+
+    bitgrid_destroy(&reference);
+    bitgrid_destroy(&bit_grid);
+}
@@ -0,0 +1,75 @@
+#include "../src/cellvec.h"
+#include <criterion/criterion.h>
+
+#define SAMPLE_DATA 10
+#define SAMPLE_DATA2 20
+#define SAMPLE_DATA3 30
+#define SAMPLE_CELL_PUSHES 10000
+
+Test(cellvec, memory_management) {
+    CellVec *cell_vec = cellvec_alloc();
+    cr_assert_not_null(cell_vec, "cellvec_alloc() returned NULL");
+    cr_assert_eq(cell_vec->len, 0);
+    cellvec_destroy(&cell_vec);
+    cr_assert_null(cell_vec, "cellvec_destroy() should make cell_vec NULL");
+}
+
+Test(cellvec, cellvec_push) {
+    CellVec *cell_vec = cellvec_alloc();
+    for (int i = 0; i < SAMPLE_CELL_PUSHES; i++) {
+        cellvec_push(cell_vec, i);
+    }
+    cr_assert_eq(cell_vec->len, SAMPLE_CELL_PUSHES,
+                 "cellvec_push() should push %d instead of %d",
+                 SAMPLE_CELL_PUSHES, cell_vec->len);
+    cr_assert_geq(cell_vec->capacity, cell_vec->len);
+    for (int i = 0; i < SAMPLE_CELL_PUSHES; i++) {
+        cr_assert_eq(cell_vec->data[i], i);
+    }
+    cellvec_destroy(&cell_vec);
+}
+
+Test(cellvec, cellvec_swap_remove) {
+    CellVec *cell_vec = cellvec_alloc();
+    cellvec_push(cell_vec, SAMPLE_DATA);
+    cellvec_push(cell_vec, SAMPLE_DATA2);
+    cellvec_push(cell_vec, SAMPLE_DATA3);
+
+    cellvec_swap_remove(cell_vec, cellvec_find(cell_vec, SAMPLE_DATA));
+    cr_assert_eq(cell_vec->len, 2);
+    cr_assert_eq(cell_vec->data[0], SAMPLE_DATA3);
+    cr_assert_eq(cellvec_find(cell_vec, SAMPLE_DATA), -1);
+
+    // Out of range indexes are ignored
+    cellvec_swap_remove(cell_vec, -1);
+    cellvec_swap_remove(cell_vec, 2);
+    cr_assert_eq(cell_vec->len, 2);
+
+    cellvec_swap_remove(cell_vec, 1);
+    cellvec_swap_remove(cell_vec, 0);
+    cr_assert_eq(cell_vec->len, 0);
+    cellvec_destroy(&cell_vec);
+}
+
+Test(cellvec, cellvec_append_and_clear) {
+    CellVec *cell_vec = cellvec_alloc();
+    CellVec *other = cellvec_alloc();
+    cellvec_push(cell_vec, SAMPLE_DATA);
+    for (int i = 0; i < SAMPLE_CELL_PUSHES; i++) {
+        cellvec_push(other, i);
+    }
+
+    cellvec_append(cell_vec, other);
+    cr_assert_eq(cell_vec->len, SAMPLE_CELL_PUSHES + 1);
+    cr_assert_eq(cell_vec->data[0], SAMPLE_DATA);
+    cr_assert_eq(cell_vec->data[SAMPLE_CELL_PUSHES], SAMPLE_CELL_PUSHES - 1);
+
+    int capacity = cell_vec->capacity;
+    cellvec_clear(cell_vec);
+    cr_assert_eq(cell_vec->len, 0);
+    cr_assert_eq(cell_vec->capacity, capacity,
+                 "cellvec_clear() should keep the storage");
+
+    cellvec_destroy(&cell_vec);
+    cellvec_destroy(&other);
+}
@@ -0,0 +1,188 @@
+#include "../src/checkpoint.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+static inline int random_betewen(int lower, int upper) {
+    return (rand() % (upper - lower + 1)) + lower;
+}
+
+static char checkpoint_path[64];
+
+void init_checkpoint() {
+    srand(time(NULL));
+    snprintf(checkpoint_path, sizeof(checkpoint_path),
+             "/tmp/agolic_checkpoint_%d.ckpt", (int)getpid());
+}
+
+void remove_checkpoint() { unlink(checkpoint_path); }
+
+TestSuite(checkpoint, .init = init_checkpoint, .fini = remove_checkpoint);
+
+Test(checkpoint, golstate_round_trip) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    LifeRule rule;
+    cr_assert(liferule_parse("B36/S23", &rule));
+    golstate_set_rule(gol_state, rule);
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+    }
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    cr_assert(checkpoint_save_golstate(gol_state, checkpoint_path));
+
+    GolState *restored = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    golstate_arbitrary_give_birth_cell(restored, 42);
+    cr_assert(checkpoint_load_golstate(restored, checkpoint_path));
+    cr_assert_eq(restored->generation, 1);
+    cr_assert_eq(restored->population, gol_state->population);
+    cr_assert_arr_eq(restored->grid, gol_state->grid, restored->cells);
+    cr_assert_eq(restored->alive_cells->len, restored->population);
+    cr_assert_eq(restored->rule.transitions, rule.transitions);
+
+    // Both continue the same way
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    golstate_analyze_generation(restored);
+    golstate_next_generation(restored);
+    cr_assert_arr_eq(restored->grid, gol_state->grid, restored->cells);
+
+    // BitGrid only runs B3/S23
+    BitGrid *bit_grid = bitgrid_alloc();
+    cr_assert_not(checkpoint_load_bitgrid(bit_grid, checkpoint_path));
+    bitgrid_destroy(&bit_grid);
+
+    golstate_destroy(&gol_state);
+    golstate_destroy(&restored);
+}
+
+Test(checkpoint, golstate_empty_rule) {
+    // B/S has no transitions at all, it is kept as it is
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    LifeRule rule;
+    cr_assert(liferule_parse("B/S", &rule));
+    cr_assert_eq(rule.transitions, 0);
+    golstate_set_rule(gol_state, rule);
+    golstate_arbitrary_give_birth_cell(gol_state, 42);
+    cr_assert(checkpoint_save_golstate(gol_state, checkpoint_path));
+
+    GolState *restored = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    cr_assert(checkpoint_load_golstate(restored, checkpoint_path));
+    cr_assert_eq(restored->rule.transitions, 0);
+    BitGrid *bit_grid = bitgrid_alloc();
+    cr_assert_not(checkpoint_load_bitgrid(bit_grid, checkpoint_path));
+    bitgrid_destroy(&bit_grid);
+
+    golstate_destroy(&gol_state);
+    golstate_destroy(&restored);
+}
+
+Test(checkpoint, golstate_topology) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_TORUS);
+    // Blinker across the right edge
+    int row = GRID_WIDTH * 10;
+    golstate_arbitrary_give_birth_cell(gol_state, row + GRID_WIDTH - 1);
+    golstate_arbitrary_give_birth_cell(gol_state, row);
+    golstate_arbitrary_give_birth_cell(gol_state, row + 1);
+    cr_assert(checkpoint_save_golstate(gol_state, checkpoint_path));
+
+    GolState *restored = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    cr_assert(checkpoint_load_golstate(restored, checkpoint_path));
+    cr_assert_eq(restored->topology, GOLSTATE_TOPOLOGY_TORUS);
+    golstate_analyze_generation(restored);
+    golstate_next_generation(restored);
+    cr_assert_eq(restored->population, 3);
+    cr_assert(golstate_is_cell_alive(restored, row - GRID_WIDTH));
+
+    // BitGrid only runs bounded grids
+    BitGrid *bit_grid = bitgrid_alloc();
+    cr_assert_not(checkpoint_load_bitgrid(bit_grid, checkpoint_path));
+    bitgrid_destroy(&bit_grid);
+
+    golstate_destroy(&gol_state);
+    golstate_destroy(&restored);
+}
+
+Test(checkpoint, bitgrid_matches_golstate) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+    }
+    cr_assert(checkpoint_save_golstate(gol_state, checkpoint_path));
+
+    // GolState checkpoints can be restored into a BitGrid and back
+    BitGrid *bit_grid = bitgrid_alloc();
+    cr_assert(checkpoint_load_bitgrid(bit_grid, checkpoint_path));
+    cr_assert_eq(bit_grid->population, gol_state->population);
+    for (int i = 0; i < GRID_SIZE; i++) {
+        cr_assert_eq(bitgrid_is_cell_alive(bit_grid, i),
+                     golstate_is_cell_alive(gol_state, i));
+    }
+
+    bitgrid_next_generation(bit_grid);
+    cr_assert(checkpoint_save_bitgrid(bit_grid, checkpoint_path));
+    BitGrid *restored = bitgrid_alloc();
+    cr_assert(checkpoint_load_bitgrid(restored, checkpoint_path));
+    cr_assert_eq(restored->generation, 1);
+    cr_assert_eq(restored->population, bit_grid->population);
+    cr_assert_arr_eq(restored->cells, bit_grid->cells,
+                     BITGRID_WORDS * sizeof(*restored->cells));
+
+    golstate_destroy(&gol_state);
+    bitgrid_destroy(&bit_grid);
+    bitgrid_destroy(&restored);
+}
+
+Test(checkpoint, rejects_corrupted_files) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    golstate_arbitrary_give_birth_cell(gol_state, GRID_SIZE / 2);
+    cr_assert(checkpoint_save_golstate(gol_state, checkpoint_path));
+
+    CheckpointMapping mapping;
+    cr_assert(checkpoint_map(checkpoint_path, &mapping));
+    cr_assert_eq(mapping.header->population, 1);
+    checkpoint_unmap(&mapping);
+
+    // Flip a bit of the bitmap, then of the header
+    long offsets[] = {sizeof(CheckpointHeader) + 100,
+                      offsetof(CheckpointHeader, generation)};
+    for (int i = 0; i < 2; i++) {
+        cr_assert(checkpoint_save_golstate(gol_state, checkpoint_path));
+        FILE *file = fopen(checkpoint_path, "r+b");
+        fseek(file, offsets[i], SEEK_SET);
+        int byte = fgetc(file);
+        fseek(file, offsets[i], SEEK_SET);
+        fputc(byte ^ 1, file);
+        fclose(file);
+        cr_assert_not(checkpoint_load_golstate(gol_state, checkpoint_path),
+                      "Corruption at offset %ld was not detected",
+                      offsets[i]);
+    }
+
+    // Checksums match but the cells do not, the GolState is kept as it was
+    BitGrid *bit_grid = bitgrid_alloc();
+    bit_grid->cells[0] = 1;
+    bit_grid->population = 2;
+    cr_assert(checkpoint_save_bitgrid(bit_grid, checkpoint_path));
+    cr_assert_not(checkpoint_load_golstate(gol_state, checkpoint_path));
+    bit_grid->cells[0] = 0;
+    bit_grid->cells[BITGRID_ROW_WORDS - 1] =
+        (uint64_t)1 << (GRID_WIDTH % BITGRID_WORD_BITS);
+    bit_grid->population = 1;
+    cr_assert(checkpoint_save_bitgrid(bit_grid, checkpoint_path));
+    cr_assert_not(checkpoint_load_golstate(gol_state, checkpoint_path));
+    bitgrid_destroy(&bit_grid);
+    cr_assert_eq(gol_state->population, 1);
+    cr_assert(golstate_is_cell_alive(gol_state, GRID_SIZE / 2));
+
+    // Truncated and missing files
+    cr_assert(truncate(checkpoint_path, sizeof(CheckpointHeader)) == 0);
+    cr_assert_not(checkpoint_load_golstate(gol_state, checkpoint_path));
+    unlink(checkpoint_path);
+    cr_assert_not(checkpoint_load_golstate(gol_state, checkpoint_path));
+
+    golstate_destroy(&gol_state);
+}
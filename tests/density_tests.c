@@ -0,0 +1,85 @@
+#include "../src/density.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+#include <time.h>
+
+static inline int random_betewen(int lower, int upper) {
+    return (rand() % (upper - lower + 1)) + lower;
+}
+
+static void init_seed() { srand(time(NULL)); }
+
+TestSuite(density, .init = init_seed);
+
+// Every level is the sum of the blocks of the level below
+static void assert_levels_consistent(DensityPyramid *density,
+                                     const bool *grid) {
+    for (int level = 1; level <= DENSITY_LEVELS; level++) {
+        int width = DENSITY_LEVEL_WIDTH(level);
+        for (int y = 0; y < width; y++) {
+            for (int x = 0; x < width; x++) {
+                int count = 0;
+                for (int dy = 0; dy < 2; dy++) {
+                    for (int dx = 0; dx < 2; dx++) {
+                        int below_x = 2 * x + dx, below_y = 2 * y + dy;
+                        if (level == 1) {
+                            if (below_x < GRID_WIDTH && below_y < GRID_WIDTH)
+                                count += grid[below_y * GRID_WIDTH + below_x];
+                        } else if (below_x < DENSITY_LEVEL_WIDTH(level - 1) &&
+                                   below_y < DENSITY_LEVEL_WIDTH(level - 1)) {
+                            count += density_get(density, level - 1, below_x,
+                                                 below_y);
+                        }
+                    }
+                }
+                cr_assert_eq(density_get(density, level, x, y), count,
+                             "Level %d block (%d, %d)", level, x, y);
+            }
+        }
+    }
+}
+
+Test(density, memory_management) {
+    DensityPyramid *density = density_alloc();
+    cr_assert_not_null(density, "density_alloc() returned NULL");
+    cr_assert_eq(density_get(density, DENSITY_LEVELS, 0, 0), 0);
+    density_destroy(&density);
+    cr_assert_null(density, "density_destroy() should make density NULL");
+}
+
+Test(density, changes_match_rebuild) {
+    DensityPyramid *density = density_alloc();
+    bool *grid = calloc(GRID_SIZE, sizeof(*grid));
+    int32_t *cells = malloc(GRID_SIZE * sizeof(*cells));
+    int32_t *changes = malloc(GRID_SIZE * sizeof(*changes));
+    cr_assert(density && grid && cells && changes);
+
+    int len = 0;
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 40)) {
+        grid[i] = true;
+        cells[len++] = i;
+    }
+    density_rebuild(density, cells, len);
+    assert_levels_consistent(density, grid);
+
+    // Flip random cells, last row and column included
+    int changes_len = 0;
+    for (int i = 0; i < 10000; i++) {
+        int cell = random_betewen(0, GRID_SIZE - 1);
+        if (i % 100 == 0)
+            cell = GRID_SIZE - 1 - i / 100;
+        grid[cell] = !grid[cell];
+        changes[changes_len++] = grid[cell] ? cell : ~cell;
+    }
+    density_apply_changes(density, changes, changes_len);
+    assert_levels_consistent(density, grid);
+
+    density_clear(density);
+    cr_assert_eq(density_get(density, 1, 0, 0), 0);
+    cr_assert_eq(density_get(density, DENSITY_LEVELS, 0, 0), 0);
+
+    free(changes);
+    free(cells);
+    free(grid);
+    density_destroy(&density);
+}
@@ -12,35 +12,80 @@ void init_seed() { srand(time(NULL)); }
 TestSuite(golstate, .init = init_seed);
 
 Test(golstate, golstate_alloc) {
-    GolState *gol_state = golstate_alloc();
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
     cr_assert_not_null(gol_state, "golstate_alloc() returned NULL");
     golstate_destroy(&gol_state);
     cr_assert_null(gol_state, "golstate_destroy() returned not NULL");
+    // Failed allocations can be destroyed too
+    golstate_destroy(&gol_state);
+
+    // Cell indexes of the storage have to fit an int32_t
+    cr_assert_null(golstate_alloc(0, GRID_WIDTH));
+    cr_assert_null(golstate_alloc(GOLSTATE_MAX_WIDTH + 1, 1));
+    cr_assert_null(golstate_alloc(GOLSTATE_MAX_WIDTH, GOLSTATE_MAX_WIDTH));
+    gol_state = golstate_alloc(GOLSTATE_MAX_WIDTH, 1000);
+    cr_assert_not_null(gol_state);
+    int last_cell = 1000 * GOLSTATE_MAX_WIDTH - 1;
+    golstate_arbitrary_give_birth_cell(gol_state, last_cell);
+    cr_assert(golstate_is_cell_alive(gol_state, last_cell));
+    golstate_destroy(&gol_state);
+}
+
+Test(golstate, runtime_dimensions) {
+    // A blinker on the last row of a wide and short grid
+    int width = 37, height = 5;
+    GolState *gol_state = golstate_alloc(width, height);
+    cr_assert_not_null(gol_state);
+    int last_row = (height - 1) * width;
+    for (int x = width - 3; x < width; x++) {
+        golstate_arbitrary_give_birth_cell(gol_state, last_row + x);
+    }
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    cr_assert_eq(gol_state->population, 2);
+    cr_assert(golstate_is_cell_alive(gol_state, last_row + width - 2));
+    cr_assert(golstate_is_cell_alive(gol_state, last_row - 2));
+
+    // Wrapping around the bottom edge it turns completely
+    golstate_restart(gol_state);
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_TORUS);
+    for (int x = width - 3; x < width; x++) {
+        golstate_arbitrary_give_birth_cell(gol_state, last_row + x);
+    }
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    cr_assert_eq(gol_state->population, 3);
+    cr_assert(golstate_is_cell_alive(gol_state, width - 2));
+    golstate_destroy(&gol_state);
 }
 
 Test(golstate, golstate_restart) {
-    GolState *gol_state = golstate_alloc();
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
     for (int i = 0; i < GRID_SIZE; i += random_betewen(10, 20)) {
         golstate_arbitrary_give_birth_cell(gol_state, i);
     }
     golstate_analyze_generation(gol_state);
 
     golstate_restart(gol_state);
-    cr_assert_null(gol_state->alive_cells,
-                   "alive_cells should be NULL after restart");
-    cr_assert_null(gol_state->becoming_alive_cells,
-                   "becoming_alive_cells should be NULL after restart");
-    cr_assert_null(gol_state->dying_cells,
-                   "dying_cells should be NULL after restart");
+    cr_assert_eq(gol_state->alive_cells->len, 0,
+                 "alive_cells should be empty after restart");
+    cr_assert_eq(gol_state->becoming_alive_cells->len, 0,
+                 "becoming_alive_cells should be empty after restart");
+    cr_assert_eq(gol_state->dying_cells->len, 0,
+                 "dying_cells should be empty after restart");
     cr_assert_eq(gol_state->population, 0,
                  "population should be 0 after restart");
     cr_assert_eq(gol_state->generation, 0,
                  "generation shoul be 0 after restart");
+    for (int i = 0; i < GRID_SIZE; i++) {
+        cr_assert_not(golstate_is_cell_alive(gol_state, i),
+                      "Cell %d should be dead after restart", i);
+    }
     golstate_destroy(&gol_state);
 }
 
 Test(golstate, no_population) {
-    GolState *gol_state = golstate_alloc();
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
     for (int i = 0; i < 5; i++) {
         golstate_analyze_generation(gol_state);
         golstate_next_generation(gol_state);
@@ -51,7 +96,7 @@ Test(golstate, no_population) {
 }
 
 Test(golstate, still_life) {
-    GolState *gol_state = golstate_alloc();
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
 
     int expected_population = 0;
 
@@ -81,7 +126,7 @@ Test(golstate, still_life) {
 }
 
 Test(golstate, inner_coherence) {
-    GolState *gol_state = golstate_alloc();
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
 
     for (int i = 0; i < GRID_SIZE; i += random_betewen(10, 20)) {
         golstate_arbitrary_give_birth_cell(gol_state, i);
@@ -90,7 +135,7 @@ Test(golstate, inner_coherence) {
     for (int i = 0; i < 5; i++) {
         golstate_analyze_generation(gol_state);
         golstate_next_generation(gol_state);
-        int len = node_len(gol_state->alive_cells);
+        int len = gol_state->alive_cells->len;
         cr_assert_eq(
             len, gol_state->population,
             "Inner incoherence, alive_cells length %d and population %d", len,
@@ -101,7 +146,7 @@ Test(golstate, inner_coherence) {
 }
 
 Test(golstate, grid_limits) {
-    GolState *gol_state = golstate_alloc();
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
 
     // x axis
     // northwest
@@ -198,8 +243,8 @@ Test(golstate, grid_limits) {
     golstate_destroy(&gol_state);
 }
 
-Test(golstate, recycled_nodes) {
-    GolState *gol_state = golstate_alloc();
+Test(golstate, reused_cell_storage) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
 
     // Add square
     golstate_arbitrary_give_birth_cell(gol_state, 0);
@@ -219,18 +264,20 @@ Test(golstate, recycled_nodes) {
     golstate_arbitrary_give_birth_cell(gol_state, GRID_WIDTH - 1);
 
     golstate_analyze_generation(gol_state);
-    cr_assert_not_null(gol_state->dying_cells);
+    cr_assert_eq(gol_state->dying_cells->len, 1);
 
     golstate_next_generation(gol_state);
 
     cr_assert_eq(gol_state->population, 10);
-    cr_assert_not_null(gol_state->recycled_cells);
+    cr_assert_eq(gol_state->dying_cells->len, 0);
+    cr_assert_gt(gol_state->dying_cells->capacity, 0,
+                 "dying_cells storage should be kept for reuse");
 
     golstate_destroy(&gol_state);
 }
 
 Test(golstate, evolution) {
-    GolState *gol_state = golstate_alloc();
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
 
     int position = GRID_SIZE / 2 + GRID_WIDTH / 2;
 
@@ -264,3 +311,353 @@ Test(golstate, evolution) {
 
     golstate_destroy(&gol_state);
 }
+
+Test(golstate, scatter_matches_neighborhood) {
+    GolState *reference = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    golstate_set_step_mode(reference, GOLSTATE_STEP_NEIGHBORHOOD);
+    cr_assert_eq(gol_state->step_mode, GOLSTATE_STEP_SCATTER);
+
+    // Dense enough to reach the grid limits
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        golstate_arbitrary_give_birth_cell(reference, i);
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+    }
+
+    for (int generation = 0; generation < 5; generation++) {
+        golstate_analyze_generation(reference);
+        golstate_next_generation(reference);
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert_eq(gol_state->population, reference->population,
+                     "Generation %d: population %d, expected %d", generation,
+                     gol_state->population, reference->population);
+        cr_assert_arr_eq(gol_state->grid, reference->grid,
+                         gol_state->cells,
+                         "Generation %d: grid differs from NEIGHBORHOOD",
+                         generation);
+        cr_assert_eq(gol_state->candidate_cells->len, 0);
+    }
+
+    golstate_destroy(&reference);
+    golstate_destroy(&gol_state);
+}
+
+Test(golstate, analysis_epoch_wraparound) {
+    const int width = 64;
+    GolState *reference = golstate_alloc(width, width);
+    GolState *gol_state = golstate_alloc(width, width);
+    golstate_set_step_mode(gol_state, GOLSTATE_STEP_NEIGHBORHOOD);
+    golstate_set_topology(reference, GOLSTATE_TOPOLOGY_TORUS);
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_TORUS);
+    for (int i = 0; i < width * width; i += random_betewen(1, 4)) {
+        golstate_arbitrary_give_birth_cell(reference, i);
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+    }
+
+    // Marks left by earlier epochs must never pass for current ones
+    uint8_t first_epoch = gol_state->analysis_epoch;
+    bool wrapped = false;
+    for (int generation = 0; generation < 600; generation++) {
+        golstate_analyze_generation(reference);
+        golstate_next_generation(reference);
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert_neq(gol_state->analysis_epoch, 0);
+        wrapped |= gol_state->analysis_epoch == first_epoch;
+        cr_assert_eq(gol_state->population, reference->population,
+                     "Generation %d: population %d, expected %d", generation,
+                     gol_state->population, reference->population);
+        for (int i = 0; i < width * width; i++) {
+            cr_assert_eq(golstate_is_cell_alive(gol_state, i),
+                         golstate_is_cell_alive(reference, i),
+                         "Generation %d: cell %d differs from SCATTER",
+                         generation, i);
+        }
+    }
+    cr_assert(wrapped, "The analysis epoch should have wrapped around");
+
+    golstate_destroy(&reference);
+    golstate_destroy(&gol_state);
+}
+
+Test(golstate, life_like_rules) {
+    const char *rules[] = {"B36/S23", "B3678/S34678", "B2/S", "B1/S1"};
+    for (size_t r = 0; r < sizeof(rules) / sizeof(*rules); r++) {
+        LifeRule rule;
+        cr_assert(liferule_parse(rules[r], &rule));
+        GolState *reference = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+        GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+        golstate_set_step_mode(reference, GOLSTATE_STEP_NEIGHBORHOOD);
+        golstate_set_rule(reference, rule);
+        golstate_set_rule(gol_state, rule);
+        for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 40)) {
+            golstate_arbitrary_give_birth_cell(reference, i);
+            golstate_arbitrary_give_birth_cell(gol_state, i);
+        }
+
+        for (int generation = 0; generation < 3; generation++) {
+            golstate_analyze_generation(reference);
+            golstate_next_generation(reference);
+            golstate_analyze_generation(gol_state);
+            golstate_next_generation(gol_state);
+            cr_assert_arr_eq(gol_state->grid, reference->grid,
+                             gol_state->cells,
+                             "%s generation %d: grid differs from "
+                             "NEIGHBORHOOD",
+                             rules[r], generation);
+        }
+        golstate_destroy(&reference);
+        golstate_destroy(&gol_state);
+    }
+
+    // In HighLife a dead cell with 6 neighbors is born, two rows of three
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    LifeRule rule;
+    cr_assert(liferule_parse("B36/S23", &rule));
+    golstate_set_rule(gol_state, rule);
+    int center = GRID_SIZE / 2 + GRID_WIDTH / 2;
+    for (int dx = -1; dx <= 1; dx++) {
+        golstate_arbitrary_give_birth_cell(gol_state, center - GRID_WIDTH + dx);
+        golstate_arbitrary_give_birth_cell(gol_state, center + GRID_WIDTH + dx);
+    }
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    cr_assert(golstate_is_cell_alive(gol_state, center));
+
+    // Restarting keeps the rule
+    golstate_restart(gol_state);
+    cr_assert_eq(gol_state->rule.transitions, rule.transitions);
+    golstate_destroy(&gol_state);
+}
+
+Test(golstate, bulk_births_and_kills) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+
+    int count = GRID_SIZE / 4;
+    int *grid_indexes = malloc(count * sizeof(*grid_indexes));
+    for (int i = 0; i < count; i++) {
+        grid_indexes[i] = i * 4;
+    }
+    golstate_give_birth_cells(gol_state, grid_indexes, count);
+    cr_assert_eq(gol_state->population, count);
+
+    // Kill every other cell, in a different order than births
+    int killed = 0;
+    for (int i = count - 1; i >= 0; i -= 2) {
+        grid_indexes[killed++] = i * 4;
+    }
+    golstate_kill_cells(gol_state, grid_indexes, killed);
+    cr_assert_eq(gol_state->population, count - killed);
+
+    CellVec *alive_cells = gol_state->alive_cells;
+    cr_assert_eq(alive_cells->len, gol_state->population);
+    for (int i = 0; i < alive_cells->len; i++) {
+        int cell = alive_cells->data[i];
+        cr_assert(gol_state->grid[cell], "Cell %d should be alive", cell);
+        cr_assert_eq(gol_state->alive_slots[cell], i,
+                     "Cell %d should be in slot %d", cell, i);
+    }
+
+    // Slots stay valid across generations
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    while (alive_cells->len) {
+        int cell = alive_cells->data[alive_cells->len / 2];
+        golstate_arbitrary_kill_cell(gol_state,
+                                     golstate_grid_index_of(gol_state, cell));
+    }
+    cr_assert_eq(gol_state->population, 0);
+
+    free(grid_indexes);
+    golstate_destroy(&gol_state);
+}
+
+Test(golstate, generation_stats) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+    }
+
+    uint64_t births = 0, deaths = 0;
+    int generations = GOLSTATE_STATS_WINDOW + 10;
+    for (int i = 0; i < generations; i++) {
+        golstate_analyze_generation(gol_state);
+        births += gol_state->becoming_alive_cells->len;
+        deaths += gol_state->dying_cells->len;
+        golstate_next_generation(gol_state);
+    }
+
+    GolStateStats stats;
+    GolStateGenerationStats window_total;
+    golstate_get_stats(gol_state, &stats, &window_total);
+    if (!GOLSTATE_STATS_ENABLED) {
+        cr_assert_eq(stats.generations, 0);
+        golstate_destroy(&gol_state);
+        return;
+    }
+    cr_assert_eq(stats.generations, (uint64_t)generations);
+    cr_assert_eq(stats.total.births, births);
+    cr_assert_eq(stats.total.deaths, deaths);
+    cr_assert_eq(stats.window_len, GOLSTATE_STATS_WINDOW);
+    cr_assert_eq(stats.window_next, generations % GOLSTATE_STATS_WINDOW);
+    cr_assert_leq(window_total.births, stats.total.births);
+    cr_assert_gt(stats.total.cells_examined, 0);
+    cr_assert_gt(stats.total.bytes_touched, 0);
+    cr_assert_gt(stats.total.phase_ns[GOLSTATE_PHASE_ANALYZE], 0);
+    int last = (stats.window_next + GOLSTATE_STATS_WINDOW - 1) %
+               GOLSTATE_STATS_WINDOW;
+    cr_assert_eq(stats.window[last].births, stats.last.births);
+    cr_assert_gt(stats.storage_blocks, 0);
+    cr_assert_geq(stats.storage_live_bytes,
+                  gol_state->population * sizeof(int32_t));
+    cr_assert_leq(stats.storage_live_bytes, stats.storage_bytes);
+    cr_assert_leq(stats.storage_bytes, stats.storage_peak_bytes);
+
+    golstate_restart(gol_state);
+    golstate_get_stats(gol_state, &stats, NULL);
+    cr_assert_eq(stats.generations, 0);
+    cr_assert_eq(stats.total.births, 0);
+    golstate_destroy(&gol_state);
+}
+
+Test(golstate, cycles) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    int center = GRID_SIZE / 2 + GRID_WIDTH / 2;
+    int period, start;
+
+    // Blinker, period 2 from the first generation
+    for (int dx = -1; dx <= 1; dx++) {
+        golstate_arbitrary_give_birth_cell(gol_state, center + dx);
+    }
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    cr_assert_not(golstate_get_cycle(gol_state, &period, &start));
+    for (int i = 0; i < 5; i++) {
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert(golstate_get_cycle(gol_state, &period, &start));
+        cr_assert_eq(period, 2);
+        cr_assert_eq(start, 0);
+    }
+
+    // An edit starts a new history, a block is stable after its first step
+    golstate_arbitrary_kill_cell(gol_state, center - 1);
+    golstate_arbitrary_give_birth_cell(gol_state, center + GRID_WIDTH);
+    golstate_arbitrary_give_birth_cell(gol_state, center + GRID_WIDTH + 1);
+    cr_assert_not(golstate_get_cycle(gol_state, NULL, NULL));
+    int generation = gol_state->generation;
+    golstate_analyze_generation(gol_state);
+    golstate_next_generation(gol_state);
+    cr_assert(golstate_get_cycle(gol_state, &period, &start));
+    cr_assert_eq(period, 1);
+    cr_assert_eq(start, generation);
+
+    // The same cells have the same hash however they were reached
+    GolState *copy = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    CellVec *grid_indexes = cellvec_alloc();
+    golstate_get_grid_indexes(gol_state, grid_indexes);
+    golstate_give_birth_cells(copy, grid_indexes->data, grid_indexes->len);
+    cellvec_destroy(&grid_indexes);
+    cr_assert_eq(copy->hash, gol_state->hash);
+    golstate_destroy(&copy);
+
+    // A glider moves, it never repeats
+    golstate_restart(gol_state);
+    int glider[] = {1, GRID_WIDTH + 2, GRID_WIDTH * 2, GRID_WIDTH * 2 + 1,
+                    GRID_WIDTH * 2 + 2};
+    for (int i = 0; i < 5; i++) {
+        golstate_arbitrary_give_birth_cell(gol_state, center + glider[i]);
+    }
+    for (int i = 0; i < 40; i++) {
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert_not(golstate_get_cycle(gol_state, NULL, NULL));
+    }
+
+    // Longer periods than the limit are not reported
+    golstate_restart(gol_state);
+    golstate_set_cycle_detection(gol_state, 1);
+    for (int dx = -1; dx <= 1; dx++) {
+        golstate_arbitrary_give_birth_cell(gol_state, center + dx);
+    }
+    for (int i = 0; i < 5; i++) {
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert_not(golstate_get_cycle(gol_state, NULL, NULL));
+    }
+    golstate_destroy(&gol_state);
+}
+
+Test(golstate, torus) {
+    GolStateStepMode modes[] = {GOLSTATE_STEP_SCATTER,
+                                GOLSTATE_STEP_NEIGHBORHOOD};
+    for (int m = 0; m < 2; m++) {
+        GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+        golstate_set_step_mode(gol_state, modes[m]);
+
+        // A blinker across the left and right edges dies when bounded
+        int row = GRID_SIZE / 2;
+        int blinker[] = {row + GRID_WIDTH - 1, row, row + 1};
+        golstate_give_birth_cells(gol_state, blinker, 3);
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert_eq(gol_state->population, 0);
+
+        // and turns around the first column on a torus
+        golstate_restart(gol_state);
+        golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_TORUS);
+        golstate_give_birth_cells(gol_state, blinker, 3);
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert_eq(gol_state->population, 3);
+        cr_assert(golstate_is_cell_alive(gol_state, row - GRID_WIDTH));
+        cr_assert(golstate_is_cell_alive(gol_state, row));
+        cr_assert(golstate_is_cell_alive(gol_state, row + GRID_WIDTH));
+
+        // A glider through the corner is back in place after crossing the
+        // grid once
+        golstate_restart(gol_state);
+        int corner = GRID_SIZE - GRID_WIDTH * 2 - 3;
+        int glider[] = {corner + 1, corner + GRID_WIDTH + 2,
+                        corner + GRID_WIDTH * 2, corner + GRID_WIDTH * 2 + 1,
+                        corner + GRID_WIDTH * 2 + 2};
+        golstate_give_birth_cells(gol_state, glider, 5);
+        for (int i = 0; i < GRID_WIDTH * 4; i++) {
+            golstate_analyze_generation(gol_state);
+            golstate_next_generation(gol_state);
+        }
+        cr_assert_eq(gol_state->population, 5);
+        for (int i = 0; i < 5; i++) {
+            cr_assert(golstate_is_cell_alive(gol_state, glider[i]),
+                      "Glider cell %d should be alive", i);
+        }
+        golstate_destroy(&gol_state);
+    }
+
+    // Both step modes wrap the same way
+    GolState *reference = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    golstate_set_step_mode(reference, GOLSTATE_STEP_NEIGHBORHOOD);
+    golstate_set_topology(reference, GOLSTATE_TOPOLOGY_TORUS);
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_TORUS);
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        golstate_arbitrary_give_birth_cell(reference, i);
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+    }
+    for (int generation = 0; generation < 3; generation++) {
+        golstate_analyze_generation(reference);
+        golstate_next_generation(reference);
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        cr_assert_eq(gol_state->population, reference->population);
+        for (int i = 0; i < GRID_SIZE; i++) {
+            cr_assert_eq(golstate_is_cell_alive(gol_state, i),
+                         golstate_is_cell_alive(reference, i),
+                         "Generation %d: cell %d differs from NEIGHBORHOOD",
+                         generation, i);
+        }
+    }
+    golstate_destroy(&reference);
+    golstate_destroy(&gol_state);
+}
@@ -0,0 +1,187 @@
+#include "../src/hashlife.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+#include <time.h>
+
+void init_seed() { srand(time(NULL)); }
+
+TestSuite(hashlife, .init = init_seed);
+
+static void hashlife_add_r_pentomino(HashLife *hash_life) {
+    hashlife_arbitrary_give_birth_cell(hash_life, 1, 0);
+    hashlife_arbitrary_give_birth_cell(hash_life, 2, 0);
+    hashlife_arbitrary_give_birth_cell(hash_life, 0, 1);
+    hashlife_arbitrary_give_birth_cell(hash_life, 1, 1);
+    hashlife_arbitrary_give_birth_cell(hash_life, 1, 2);
+}
+
+Test(hashlife, hashlife_alloc) {
+    HashLife *hash_life = hashlife_alloc();
+    cr_assert_not_null(hash_life, "hashlife_alloc() returned NULL");
+    cr_assert_eq(hash_life->population, 0);
+    cr_assert_eq(hash_life->generation, 0);
+    hashlife_destroy(&hash_life);
+    cr_assert_null(hash_life, "hashlife_destroy() returned not NULL");
+}
+
+Test(hashlife, give_birth_and_kill) {
+    HashLife *hash_life = hashlife_alloc();
+
+    hashlife_arbitrary_give_birth_cell(hash_life, 0, 0);
+    hashlife_arbitrary_give_birth_cell(hash_life, -1, -1);
+    hashlife_arbitrary_give_birth_cell(hash_life, 1000000, -3);
+    hashlife_arbitrary_give_birth_cell(hash_life, 1000000, -3);
+    cr_assert_eq(hash_life->population, 3);
+    cr_assert(hashlife_is_cell_alive(hash_life, 0, 0));
+    cr_assert(hashlife_is_cell_alive(hash_life, -1, -1));
+    cr_assert(hashlife_is_cell_alive(hash_life, 1000000, -3));
+    cr_assert_not(hashlife_is_cell_alive(hash_life, 1, 0));
+
+    hashlife_arbitrary_kill_cell(hash_life, -1, -1);
+    cr_assert_eq(hash_life->population, 2);
+    cr_assert_not(hashlife_is_cell_alive(hash_life, -1, -1));
+
+    hashlife_destroy(&hash_life);
+}
+
+Test(hashlife, r_pentomino_stabilizes) {
+    HashLife *hash_life = hashlife_alloc();
+    hashlife_add_r_pentomino(hash_life);
+
+    cr_assert(hashlife_advance(hash_life, 1103));
+    cr_assert_eq(hash_life->generation, 1103);
+    cr_assert_eq(hash_life->population, 116,
+                 "R-pentomino population should be 116 instead of %lu",
+                 (unsigned long)hash_life->population);
+
+    // Only the gliders keep moving, far beyond any fixed grid
+    hashlife_step(hash_life, 20);
+    cr_assert_eq(hash_life->population, 116);
+
+    hashlife_destroy(&hash_life);
+}
+
+Test(hashlife, glider_billions_of_generations) {
+    HashLife *hash_life = hashlife_alloc();
+    hashlife_arbitrary_give_birth_cell(hash_life, 1, 0);
+    hashlife_arbitrary_give_birth_cell(hash_life, 2, 1);
+    hashlife_arbitrary_give_birth_cell(hash_life, 0, 2);
+    hashlife_arbitrary_give_birth_cell(hash_life, 1, 2);
+    hashlife_arbitrary_give_birth_cell(hash_life, 2, 2);
+
+    cr_assert(hashlife_step(hash_life, 32));
+    cr_assert_eq(hash_life->generation, (uint64_t)1 << 32);
+    cr_assert_eq(hash_life->population, 5);
+
+    // A glider moves one cell diagonally every 4 generations
+    int64_t offset = (int64_t)1 << 30;
+    cr_assert(hashlife_is_cell_alive(hash_life, offset + 1, offset + 0));
+    cr_assert(hashlife_is_cell_alive(hash_life, offset + 2, offset + 1));
+    cr_assert(hashlife_is_cell_alive(hash_life, offset + 0, offset + 2));
+    cr_assert(hashlife_is_cell_alive(hash_life, offset + 1, offset + 2));
+    cr_assert(hashlife_is_cell_alive(hash_life, offset + 2, offset + 2));
+
+    // Jumps past the largest step are refused as a whole
+    cr_assert_not(hashlife_step(hash_life, HASHLIFE_MAX_STEP_LOG2 + 1));
+    cr_assert_not(hashlife_step(hash_life, -1));
+    uint64_t too_far = (uint64_t)1 << (HASHLIFE_MAX_STEP_LOG2 + 1);
+    cr_assert_not(hashlife_advance(hash_life, too_far));
+    cr_assert_not(hashlife_advance(hash_life, UINT64_MAX));
+    cr_assert_eq(hash_life->generation, (uint64_t)1 << 32);
+    cr_assert_eq(hash_life->population, 5);
+
+    hashlife_destroy(&hash_life);
+}
+
+Test(hashlife, matches_golstate) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    HashLife *hash_life = hashlife_alloc();
+
+    // Random soup far from the grid limits
+    int first = GRID_WIDTH / 2 - 32;
+    for (int y = first; y < first + 64; y++) {
+        for (int x = first; x < first + 64; x++) {
+            if (rand() % 3 == 0)
+                golstate_arbitrary_give_birth_cell(gol_state,
+                                                   y * GRID_WIDTH + x);
+        }
+    }
+    cr_assert(hashlife_load_golstate(hash_life, gol_state));
+    cr_assert_eq(hash_life->population, (uint64_t)gol_state->population);
+
+    for (int i = 0; i < 100; i++) {
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+    }
+    hashlife_advance(hash_life, 100);
+    cr_assert_eq(hash_life->population, (uint64_t)gol_state->population,
+                 "Population %lu, expected %d",
+                 (unsigned long)hash_life->population, gol_state->population);
+    for (int y = first - 100; y < first + 164; y++) {
+        for (int x = first - 100; x < first + 164; x++) {
+            cr_assert_eq(hashlife_is_cell_alive(hash_life, x, y),
+                         golstate_is_cell_alive(gol_state,
+                                                y * GRID_WIDTH + x),
+                         "Cell (%d, %d) differs from GolState", x, y);
+        }
+    }
+
+    golstate_destroy(&gol_state);
+    hashlife_destroy(&hash_life);
+}
+
+Test(hashlife, loads_large_golstate) {
+    // A blinker in the last corner of the widest grid
+    int width = GOLSTATE_MAX_WIDTH, height = 1000;
+    GolState *gol_state = golstate_alloc(width, height);
+    HashLife *hash_life = hashlife_alloc();
+    int x = width - 2, y = height - 2;
+    for (int dx = -1; dx <= 1; dx++) {
+        golstate_arbitrary_give_birth_cell(gol_state, y * width + x + dx);
+    }
+    cr_assert(hashlife_load_golstate(hash_life, gol_state));
+    cr_assert_eq(hash_life->population, 3);
+    cr_assert(hashlife_is_cell_alive(hash_life, x + 1, y));
+    cr_assert_not(hashlife_is_cell_alive(hash_life, x, y + 1));
+    hashlife_step(hash_life, 0);
+    cr_assert(hashlife_is_cell_alive(hash_life, x, y + 1));
+    cr_assert_eq(hash_life->population, 3);
+
+    golstate_destroy(&gol_state);
+    hashlife_destroy(&hash_life);
+}
+
+Test(hashlife, rejects_other_golstates) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    HashLife *hash_life = hashlife_alloc();
+    golstate_arbitrary_give_birth_cell(gol_state, 0);
+
+    LifeRule rule;
+    cr_assert(liferule_parse("B36/S23", &rule));
+    golstate_set_rule(gol_state, rule);
+    cr_assert_not(hashlife_load_golstate(hash_life, gol_state));
+    golstate_set_rule(gol_state, liferule_conway());
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_TORUS);
+    cr_assert_not(hashlife_load_golstate(hash_life, gol_state));
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_BOUNDED);
+    cr_assert(hashlife_load_golstate(hash_life, gol_state));
+    cr_assert_eq(hash_life->population, 1);
+
+    golstate_destroy(&gol_state);
+    hashlife_destroy(&hash_life);
+}
+
+Test(hashlife, memory_limit) {
+    HashLife *hash_life = hashlife_alloc();
+    hashlife_set_memory_limit(hash_life, 256 * 1024);
+    hashlife_add_r_pentomino(hash_life);
+
+    for (int i = 0; i < 1103; i++) {
+        hashlife_step(hash_life, 0);
+    }
+    cr_assert_eq(hash_life->population, 116);
+    hashlife_collect_garbage(hash_life);
+    cr_assert_leq(hashlife_memory_usage(hash_life), 1024 * 1024);
+
+    hashlife_destroy(&hash_life);
+}
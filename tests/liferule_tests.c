@@ -0,0 +1,49 @@
+#include "../src/liferule.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+
+Test(liferule, parse_and_format) {
+    const char *rules[][2] = {{"B3/S23", "B3/S23"},
+                              {"b36/s23", "B36/S23"},
+                              {"S34678/B3678", "B3678/S34678"},
+                              {"23/3", "B3/S23"},
+                              {" B2/S ", "B2/S"},
+                              {"B12345678/S012345678", "B12345678/S012345678"}};
+    for (size_t i = 0; i < sizeof(rules) / sizeof(*rules); i++) {
+        LifeRule rule;
+        cr_assert(liferule_parse(rules[i][0], &rule), "%s", rules[i][0]);
+        char text[LIFERULE_TEXT_SIZE];
+        liferule_format(rule, text, sizeof(text));
+        cr_assert_str_eq(text, rules[i][1]);
+    }
+
+    LifeRule rule;
+    cr_assert(liferule_parse("B3/S23", &rule));
+    cr_assert(liferule_is_conway(rule));
+    cr_assert(liferule_is_conway(liferule_conway()));
+    cr_assert(liferule_parse("B36/S23", &rule));
+    cr_assert_not(liferule_is_conway(rule));
+}
+
+Test(liferule, parse_errors) {
+    const char *rules[] = {"",        "B3",      "B3S23",  "B3/S29",
+                           "B3/B3",   "B0/S23",  "23/03",  "B3/S23/x",
+                           "X3/S23",  "B3/S2 3", "3",      "Life"};
+    for (size_t i = 0; i < sizeof(rules) / sizeof(*rules); i++) {
+        LifeRule rule = liferule_conway();
+        cr_assert_not(liferule_parse(rules[i], &rule), "\"%s\"", rules[i]);
+        cr_assert(liferule_is_conway(rule), "\"%s\" changed the rule",
+                  rules[i]);
+    }
+}
+
+Test(liferule, transitions) {
+    LifeRule rule;
+    cr_assert(liferule_parse("B36/S23", &rule));
+    for (int neighbors = 0; neighbors < LIFERULE_COUNTS; neighbors++) {
+        cr_assert_eq(liferule_next_state(rule.transitions, false, neighbors),
+                     neighbors == 3 || neighbors == 6);
+        cr_assert_eq(liferule_next_state(rule.transitions, true, neighbors),
+                     neighbors == 2 || neighbors == 3);
+    }
+}
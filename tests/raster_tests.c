@@ -0,0 +1,113 @@
+#include "../src/bitgrid.h"
+#include "../src/raster.h"
+#include <criterion/criterion.h>
+
+#define WINDOW_WIDTH 800
+#define WINDOW_HEIGHT 600
+
+static void set_cell(uint64_t *bitmap, int x, int y) {
+    bitmap[y * BITGRID_ROW_WORDS + x / BITGRID_WORD_BITS] |=
+        (uint64_t)1 << (x % BITGRID_WORD_BITS);
+}
+
+Test(raster, visible_area) {
+    RasterView raster_view;
+    // Whole grid on screen
+    cr_assert(raster_visible_blocks(0, 0, .1f, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                                   &raster_view));
+    cr_assert_eq(raster_view.level, 0);
+    cr_assert_eq(raster_view.first_x, 0);
+    cr_assert_eq(raster_view.first_y, 0);
+    cr_assert_eq(raster_view.width, GRID_WIDTH);
+    cr_assert_eq(raster_view.height, GRID_WIDTH);
+
+    // Zoomed in past the top left corner, partial cells count as visible
+    cr_assert(raster_visible_blocks(-105, -50, 10, 0, WINDOW_WIDTH,
+                                    WINDOW_HEIGHT, &raster_view));
+    cr_assert_eq(raster_view.first_x, 10);
+    cr_assert_eq(raster_view.first_y, 5);
+    cr_assert_eq(raster_view.width, 81);
+    cr_assert_eq(raster_view.height, 60);
+    cr_assert_eq(raster_view.screen_x, -5);
+    cr_assert_eq(raster_view.screen_y, 0);
+
+    // Grid out of the window
+    cr_assert_not(raster_visible_blocks(WINDOW_WIDTH, 0, 10, 0, WINDOW_WIDTH,
+                                        WINDOW_HEIGHT, &raster_view));
+    cr_assert_not(raster_visible_blocks(0, -GRID_WIDTH * 10.f, 10, 0,
+                                        WINDOW_WIDTH, WINDOW_HEIGHT,
+                                        &raster_view));
+
+    // Blocks of 4x4 cells, 1.2 pixels wide
+    cr_assert(raster_visible_blocks(-12, 0, .3f, 2, WINDOW_WIDTH,
+                                    WINDOW_HEIGHT, &raster_view));
+    cr_assert_eq(raster_view.level, 2);
+    cr_assert_eq(raster_view.first_x, 10);
+    cr_assert_eq(raster_view.width, DENSITY_LEVEL_WIDTH(2) - 10);
+    cr_assert_eq(raster_view.height, DENSITY_LEVEL_WIDTH(2));
+}
+
+Test(raster, rasterize) {
+    uint64_t *bitmap = calloc(BITGRID_WORDS, sizeof(*bitmap));
+    cr_assert_not_null(bitmap);
+    set_cell(bitmap, 60, 100);
+    set_cell(bitmap, 63, 100);
+    set_cell(bitmap, 64, 101);
+    set_cell(bitmap, 200, 101);
+    set_cell(bitmap, GRID_WIDTH - 1, GRID_WIDTH - 1);
+
+    RasterView raster_view = {.first_x = 50, .first_y = 100, .width = 100,
+                              .height = 2};
+    // Rows wider than the view, like a texture pitch
+    int pitch = 128 * sizeof(uint32_t);
+    uint32_t *pixels = malloc(2 * pitch);
+    cr_assert_not_null(pixels);
+    raster_cells(bitmap, &raster_view, pixels, pitch);
+    for (int row = 0; row < 2; row++) {
+        for (int i = 0; i < 100; i++) {
+            int x = 50 + i;
+            bool alive = (row == 0 && (x == 60 || x == 63)) ||
+                         (row == 1 && x == 64);
+            cr_assert_eq(pixels[row * 128 + i],
+                         alive ? RASTER_ALIVE_PIXEL : RASTER_DEAD_PIXEL,
+                         "Pixel (%d, %d)", x, 100 + row);
+        }
+    }
+
+    raster_view = (RasterView){.first_x = GRID_WIDTH - 2,
+                               .first_y = GRID_WIDTH - 1, .width = 2,
+                               .height = 1};
+    raster_cells(bitmap, &raster_view, pixels, pitch);
+    cr_assert_eq(pixels[0], RASTER_DEAD_PIXEL);
+    cr_assert_eq(pixels[1], RASTER_ALIVE_PIXEL);
+
+    free(pixels);
+    free(bitmap);
+}
+
+Test(raster, level_for_zoom) {
+    cr_assert_eq(raster_density_level(15), 0);
+    cr_assert_eq(raster_density_level(.75f), 0);
+    cr_assert_eq(raster_density_level(.5f), 1);
+    cr_assert_eq(raster_density_level(.15f), 2);
+    cr_assert_eq(raster_density_level(.001f), DENSITY_LEVELS);
+}
+
+Test(raster, rasterize_density) {
+    DensityPyramid *density = density_alloc();
+    cr_assert_not_null(density);
+    int32_t cells[] = {0, 1, GRID_WIDTH, GRID_WIDTH + 1, 2};
+    density_rebuild(density, cells, sizeof(cells) / sizeof(*cells));
+
+    RasterView raster_view = {.level = 1, .first_x = 0, .first_y = 0,
+                              .width = 3, .height = 1};
+    uint32_t pixels[3];
+    raster_density(density, &raster_view, pixels, sizeof(pixels));
+    cr_assert_eq(pixels[0], RASTER_ALIVE_PIXEL);
+    cr_assert_eq(pixels[1] & 0xffffff, RASTER_ALIVE_PIXEL & 0xffffff);
+    cr_assert_eq(pixels[1] >> 24, RASTER_MIN_DENSITY_ALPHA +
+                                      (255 - RASTER_MIN_DENSITY_ALPHA) / 4);
+    cr_assert_eq(pixels[2], RASTER_DEAD_PIXEL);
+
+    density_destroy(&density);
+}
@@ -0,0 +1,151 @@
+#include "../src/rle.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+#include <string.h>
+#include <time.h>
+
+static inline int random_betewen(int lower, int upper) {
+    return (rand() % (upper - lower + 1)) + lower;
+}
+
+void init_seed() { srand(time(NULL)); }
+
+TestSuite(rle, .init = init_seed);
+
+static FILE *rle_text(const char *text) {
+    return fmemopen((void *)text, strlen(text), "r");
+}
+
+Test(rle, load_glider) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    FILE *file = rle_text("#N Glider\n"
+                          "#C A comment\n"
+                          "x = 3, y = 3, rule = B3/S23\n"
+                          "bob$2bo$3o!\n");
+    RleHeader header;
+    cr_assert(rle_load(gol_state, file, &header));
+    fclose(file);
+
+    cr_assert_eq(header.width, 3);
+    cr_assert_eq(header.height, 3);
+    cr_assert_str_eq(header.rule, "B3/S23");
+    cr_assert_eq(gol_state->population, 5);
+
+    int origin = (GRID_WIDTH - 3) / 2 * GRID_WIDTH + (GRID_WIDTH - 3) / 2;
+    int expected[] = {1, GRID_WIDTH + 2, 2 * GRID_WIDTH,
+                      2 * GRID_WIDTH + 1, 2 * GRID_WIDTH + 2};
+    for (int i = 0; i < 5; i++) {
+        cr_assert(golstate_is_cell_alive(gol_state, origin + expected[i]),
+                  "Glider cell %d should be alive", i);
+    }
+
+    golstate_destroy(&gol_state);
+}
+
+Test(rle, load_rule) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    FILE *file = rle_text("x = 1, y = 1, rule = B36/S23\no!\n");
+    cr_assert(rle_load(gol_state, file, NULL));
+    fclose(file);
+    char rule[LIFERULE_TEXT_SIZE];
+    liferule_format(gol_state->rule, rule, sizeof(rule));
+    cr_assert_str_eq(rule, "B36/S23");
+
+    // Unsupported rules keep the current one
+    RleHeader header;
+    file = rle_text("x = 1, y = 1, rule = B0/S8\no!\n");
+    cr_assert(rle_load(gol_state, file, &header));
+    fclose(file);
+    cr_assert_str_eq(header.rule, "B0/S8");
+    liferule_format(gol_state->rule, rule, sizeof(rule));
+    cr_assert_str_eq(rule, "B36/S23");
+
+    // And files without a rule are B3/S23
+    file = rle_text("x = 1, y = 1\no!\n");
+    cr_assert(rle_load(gol_state, file, NULL));
+    fclose(file);
+    cr_assert(liferule_is_conway(gol_state->rule));
+
+    golstate_destroy(&gol_state);
+}
+
+Test(rle, load_errors) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+
+    FILE *file = rle_text("x = 3, y = 1\n3o?\n");
+    cr_assert_not(rle_load(gol_state, file, NULL));
+    fclose(file);
+
+    // Cells past the grid limits are dropped
+    golstate_restart(gol_state);
+    file = rle_text("x = 3000, y = 2, rule = B36/S23\n3000o$\n5000o!\n");
+    RleHeader header;
+    cr_assert(rle_load(gol_state, file, &header));
+    fclose(file);
+    cr_assert_str_eq(header.rule, "B36/S23");
+    cr_assert_eq(gol_state->population, 2 * GRID_WIDTH);
+
+    // Long bodies keep dropping cells once past the grid
+    golstate_restart(gol_state);
+    char body[256] = "x = 1, y = 1\no";
+    for (int i = 0; i < 10; i++) {
+        strcat(body, "399999999$399999999b");
+    }
+    strcat(body, "o!\n");
+    file = rle_text(body);
+    cr_assert(rle_load(gol_state, file, NULL));
+    fclose(file);
+    cr_assert_eq(gol_state->population, 1);
+
+    golstate_destroy(&gol_state);
+}
+
+Test(rle, save_and_load_soup) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    // Bounding box of the whole grid so loading puts cells back in place,
+    // large enough to span many chunks
+    golstate_arbitrary_give_birth_cell(gol_state, 0);
+    golstate_arbitrary_give_birth_cell(gol_state, GRID_SIZE - 1);
+    for (int i = 0; i < GRID_SIZE; i += random_betewen(1, 6)) {
+        golstate_arbitrary_give_birth_cell(gol_state, i);
+    }
+
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *file = open_memstream(&buffer, &size);
+    CellVec *grid_indexes = cellvec_alloc();
+    golstate_get_grid_indexes(gol_state, grid_indexes);
+    cr_assert(rle_save(file, grid_indexes->data, grid_indexes->len,
+                       gol_state->width, NULL));
+    cellvec_destroy(&grid_indexes);
+    fclose(file);
+    cr_assert_gt(size, RLE_CHUNK_SIZE);
+    cr_assert_eq(strncmp(buffer, "x = 2000, y = 2000, rule = B3/S23\n", 34),
+                 0);
+
+    GolState *loaded = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    file = fmemopen(buffer, size, "r");
+    cr_assert(rle_load(loaded, file, NULL));
+    fclose(file);
+    cr_assert_eq(loaded->population, gol_state->population);
+    cr_assert_arr_eq(loaded->grid, gol_state->grid, loaded->cells);
+
+    // Lines are wrapped
+    for (char *line = buffer; *line; line = strchr(line, '\n') + 1) {
+        cr_assert_leq(strcspn(line, "\n"), RLE_LINE_WIDTH);
+    }
+
+    free(buffer);
+    golstate_destroy(&gol_state);
+    golstate_destroy(&loaded);
+}
+
+Test(rle, save_empty) {
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *file = open_memstream(&buffer, &size);
+    cr_assert(rle_save(file, NULL, 0, GRID_WIDTH, "B36/S23"));
+    fclose(file);
+    cr_assert_str_eq(buffer, "x = 0, y = 0, rule = B36/S23\n!\n");
+    free(buffer);
+}
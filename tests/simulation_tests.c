@@ -0,0 +1,238 @@
+#include "../src/simulation.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+#include <string.h>
+#include <time.h>
+
+#define SNAPSHOT_TIMEOUT_SECONDS 10
+
+// Polls snapshots until the given generation and population are published,
+// any population when it is negative
+static const SimulationSnapshot *wait_for_snapshot(Simulation *simulation,
+                                                   int generation,
+                                                   int population) {
+    time_t start = time(NULL);
+    const SimulationSnapshot *snapshot = simulation_get_snapshot(simulation);
+    while (snapshot->generation < generation ||
+           (population >= 0 && snapshot->population != population)) {
+        if (time(NULL) - start > SNAPSHOT_TIMEOUT_SECONDS)
+            return NULL;
+        struct timespec wait = {0, 1000000};
+        nanosleep(&wait, NULL);
+        snapshot = simulation_get_snapshot(simulation);
+    }
+    return snapshot;
+}
+
+// Does not repeat itself until it becomes a block at the edge of the grid,
+// thousands of generations later
+static void give_birth_glider(Simulation *simulation, int cell) {
+    simulation_give_birth_cell(simulation, cell + 1);
+    simulation_give_birth_cell(simulation, cell + GRID_WIDTH + 2);
+    simulation_give_birth_cell(simulation, cell + GRID_WIDTH * 2);
+    simulation_give_birth_cell(simulation, cell + GRID_WIDTH * 2 + 1);
+    simulation_give_birth_cell(simulation, cell + GRID_WIDTH * 2 + 2);
+}
+
+static bool snapshot_bit(const SimulationSnapshot *snapshot, int cell) {
+    int x = cell % GRID_WIDTH, y = cell / GRID_WIDTH;
+    uint64_t word =
+        snapshot->bitmap[y * BITGRID_ROW_WORDS + x / BITGRID_WORD_BITS];
+    return (word >> (x % BITGRID_WORD_BITS)) & 1;
+}
+
+Test(simulation, simulation_alloc) {
+    Simulation *simulation = simulation_alloc();
+    cr_assert_not_null(simulation, "simulation_alloc() returned NULL");
+    cr_assert_not(simulation_is_running(simulation));
+    const SimulationSnapshot *snapshot = simulation_get_snapshot(simulation);
+    cr_assert_eq(snapshot->len, 0);
+    simulation_destroy(&simulation);
+    cr_assert_null(simulation, "simulation_destroy() returned not NULL");
+}
+
+Test(simulation, edits_and_steps) {
+    Simulation *simulation = simulation_alloc();
+    int center = GRID_SIZE / 2 + GRID_WIDTH / 2;
+
+    // Horizontal blinker plus a cell erased right after being drawn
+    simulation_give_birth_cell(simulation, center - 1);
+    simulation_give_birth_cell(simulation, center);
+    simulation_give_birth_cell(simulation, center + 1);
+    simulation_give_birth_cell(simulation, center + 10);
+    simulation_kill_cell(simulation, center + 10);
+    const SimulationSnapshot *snapshot = wait_for_snapshot(simulation, 0, 3);
+    cr_assert_not_null(snapshot, "Edits were not published");
+    cr_assert_eq(snapshot->len, 3);
+
+    simulation_step(simulation);
+    snapshot = wait_for_snapshot(simulation, 1, 3);
+    cr_assert_not_null(snapshot, "Step was not published");
+    bool vertical_blinker_alive[3] = {false, false, false};
+    for (int i = 0; i < snapshot->len; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (snapshot->cells[i] == center + (j - 1) * GRID_WIDTH)
+                vertical_blinker_alive[j] = true;
+        }
+    }
+    cr_assert(vertical_blinker_alive[0] && vertical_blinker_alive[1] &&
+              vertical_blinker_alive[2]);
+
+    // The bitmap matches the cells, also after the buffers are reused
+    for (int generation = 2; generation < 6; generation++) {
+        simulation_step(simulation);
+        snapshot = wait_for_snapshot(simulation, generation, 3);
+        cr_assert_not_null(snapshot, "Step was not published");
+        int step = generation % 2 ? GRID_WIDTH : 1;
+        for (int offset = -1; offset <= 1; offset++) {
+            cr_assert(snapshot_bit(snapshot, center + offset * step));
+        }
+        cr_assert_not(snapshot_bit(snapshot, center - GRID_WIDTH / step));
+        cr_assert_not(snapshot_bit(snapshot, center + GRID_WIDTH / step));
+        cr_assert_not(snapshot_bit(snapshot, center + 10));
+
+        // And so does the density pyramid
+        int width = DENSITY_LEVEL_WIDTH(DENSITY_LEVELS), population = 0;
+        for (int block = 0; block < width * width; block++) {
+            population += density_get(snapshot->density, DENSITY_LEVELS,
+                                      block % width, block / width);
+        }
+        cr_assert_eq(population, 3);
+        int x = center % GRID_WIDTH / 2, y = center / GRID_WIDTH / 2;
+        cr_assert_eq(density_get(snapshot->density, 1, x, y), 2);
+        cr_assert_eq(density_get(snapshot->density, 1, x - 1, y) +
+                         density_get(snapshot->density, 1, x, y - 1),
+                     1);
+    }
+
+    simulation_destroy(&simulation);
+}
+
+Test(simulation, runs_until_stopped) {
+    Simulation *simulation = simulation_alloc();
+    int center = GRID_SIZE / 2 + GRID_WIDTH / 2;
+    give_birth_glider(simulation, center);
+
+    simulation_set_running(simulation, true);
+    cr_assert(simulation_is_running(simulation));
+    cr_assert_not_null(wait_for_snapshot(simulation, 100, -1),
+                       "Glider did not reach generation 100");
+    simulation_set_running(simulation, false);
+
+    // Restarting publishes an empty generation 0
+    simulation_restart(simulation);
+    time_t start = time(NULL);
+    const SimulationSnapshot *snapshot = simulation_get_snapshot(simulation);
+    while (snapshot->generation != 0 || snapshot->population != 0) {
+        cr_assert_leq(time(NULL) - start, SNAPSHOT_TIMEOUT_SECONDS,
+                      "Restart was not published");
+        snapshot = simulation_get_snapshot(simulation);
+    }
+
+    // Running out of population stops the simulation
+    simulation_give_birth_cell(simulation, center);
+    simulation_set_running(simulation, true);
+    cr_assert_not_null(wait_for_snapshot(simulation, 1, 0));
+    start = time(NULL);
+    while (simulation_is_running(simulation)) {
+        cr_assert_leq(time(NULL) - start, SNAPSHOT_TIMEOUT_SECONDS,
+                      "Simulation did not stop without population");
+    }
+
+    // So does repeating, a block stops once it is seen stable
+    simulation_restart(simulation);
+    simulation_give_birth_cell(simulation, center);
+    simulation_give_birth_cell(simulation, center + 1);
+    simulation_give_birth_cell(simulation, center + GRID_WIDTH);
+    simulation_give_birth_cell(simulation, center + GRID_WIDTH + 1);
+    cr_assert_not_null(wait_for_snapshot(simulation, 0, 4));
+    simulation_set_running(simulation, true);
+    start = time(NULL);
+    while (simulation_is_running(simulation)) {
+        cr_assert_leq(time(NULL) - start, SNAPSHOT_TIMEOUT_SECONDS,
+                      "Simulation did not stop on a still life");
+    }
+    snapshot = wait_for_snapshot(simulation, 1, 4);
+    cr_assert_not_null(snapshot);
+    cr_assert_eq(snapshot->generation, 1);
+
+    // Resuming carries on with the same cycle
+    simulation_set_running(simulation, true);
+    cr_assert_not_null(wait_for_snapshot(simulation, 100, 4),
+                       "Block did not resume to generation 100");
+
+    simulation_destroy(&simulation);
+}
+
+Test(simulation, target_speed) {
+    Simulation *simulation = simulation_alloc();
+    int center = GRID_SIZE / 2 + GRID_WIDTH / 2;
+    give_birth_glider(simulation, center);
+    cr_assert_not_null(wait_for_snapshot(simulation, 0, 5));
+
+    simulation_set_speed(simulation, 20);
+    cr_assert_eq(simulation_get_speed(simulation), 20);
+    simulation_set_running(simulation, true);
+    struct timespec wait = {0, 500000000};
+    nanosleep(&wait, NULL);
+    simulation_set_running(simulation, false);
+    const SimulationSnapshot *snapshot = wait_for_snapshot(simulation, 1, 5);
+    cr_assert_not_null(snapshot);
+    // About 10 generations, not as many as the glider can be stepped
+    cr_assert_geq(snapshot->generation, 3);
+    cr_assert_leq(snapshot->generation, 20);
+
+    // Paused, nothing is published
+    nanosleep(&wait, NULL);
+    simulation_get_snapshot(simulation);
+    nanosleep(&wait, NULL);
+    cr_assert_not(simulation_has_new_snapshot(simulation));
+
+    simulation_set_speed(simulation, SIMULATION_UNLIMITED_GPS);
+    simulation_set_running(simulation, true);
+    cr_assert_not_null(wait_for_snapshot(simulation, 1000, -1),
+                       "Unlimited speed did not reach generation 1000");
+    simulation_destroy(&simulation);
+}
+
+Test(simulation, tile_stamps) {
+    Simulation *simulation = simulation_alloc();
+    int center = GRID_SIZE / 2 + GRID_WIDTH / 2;
+    int x = center % GRID_WIDTH, y = center / GRID_WIDTH;
+    int center_tile = (y >> SIMULATION_TILE_SHIFT) * SIMULATION_TILE_COLUMNS +
+                      (x >> SIMULATION_TILE_SHIFT);
+    simulation_give_birth_cell(simulation, center - 1);
+    simulation_give_birth_cell(simulation, center);
+    simulation_give_birth_cell(simulation, center + 1);
+    const SimulationSnapshot *snapshot = wait_for_snapshot(simulation, 0, 3);
+    cr_assert_not_null(snapshot);
+    uint32_t *stamps = malloc(sizeof(snapshot->tile_stamps));
+    cr_assert_not_null(stamps);
+    memcpy(stamps, snapshot->tile_stamps, sizeof(snapshot->tile_stamps));
+
+    // Only the tile of the blinker changes
+    for (int generation = 1; generation <= 3; generation++) {
+        simulation_step(simulation);
+        snapshot = wait_for_snapshot(simulation, generation, 3);
+        cr_assert_not_null(snapshot);
+        for (int tile = 0; tile < SIMULATION_TILES; tile++) {
+            if (tile == center_tile)
+                cr_assert_neq(snapshot->tile_stamps[tile], stamps[tile]);
+            else
+                cr_assert_eq(snapshot->tile_stamps[tile], stamps[tile],
+                             "Tile %d changed", tile);
+        }
+        memcpy(stamps, snapshot->tile_stamps, sizeof(snapshot->tile_stamps));
+    }
+
+    // A restart changes every tile
+    simulation_restart(simulation);
+    snapshot = wait_for_snapshot(simulation, 0, 0);
+    cr_assert_not_null(snapshot);
+    for (int tile = 0; tile < SIMULATION_TILES; tile++) {
+        cr_assert_neq(snapshot->tile_stamps[tile], stamps[tile]);
+    }
+
+    free(stamps);
+    simulation_destroy(&simulation);
+}
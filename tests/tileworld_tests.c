@@ -0,0 +1,176 @@
+#include "../src/tileworld.h"
+#include <criterion/assert.h>
+#include <criterion/criterion.h>
+#include <time.h>
+
+void init_seed() { srand(time(NULL)); }
+
+TestSuite(tileworld, .init = init_seed);
+
+static void tileworld_add_glider(TileWorld *tile_world, int64_t x, int64_t y) {
+    tileworld_arbitrary_give_birth_cell(tile_world, x + 1, y);
+    tileworld_arbitrary_give_birth_cell(tile_world, x + 2, y + 1);
+    tileworld_arbitrary_give_birth_cell(tile_world, x, y + 2);
+    tileworld_arbitrary_give_birth_cell(tile_world, x + 1, y + 2);
+    tileworld_arbitrary_give_birth_cell(tile_world, x + 2, y + 2);
+}
+
+Test(tileworld, tileworld_alloc) {
+    TileWorld *tile_world = tileworld_alloc();
+    cr_assert_not_null(tile_world, "tileworld_alloc() returned NULL");
+    cr_assert_eq(tile_world->population, 0);
+    cr_assert_eq(tile_world->tile_count, 0);
+    tileworld_destroy(&tile_world);
+    cr_assert_null(tile_world, "tileworld_destroy() returned not NULL");
+}
+
+Test(tileworld, give_birth_and_kill) {
+    TileWorld *tile_world = tileworld_alloc();
+    int64_t far = (int64_t)1 << 40;
+
+    tileworld_arbitrary_give_birth_cell(tile_world, 0, 0);
+    tileworld_arbitrary_give_birth_cell(tile_world, -1, -1);
+    tileworld_arbitrary_give_birth_cell(tile_world, far, -far);
+    tileworld_arbitrary_give_birth_cell(tile_world, far, -far);
+    cr_assert_eq(tile_world->population, 3);
+    cr_assert_eq(tile_world->tile_count, 3);
+    cr_assert(tileworld_is_cell_alive(tile_world, -1, -1));
+    cr_assert(tileworld_is_cell_alive(tile_world, far, -far));
+    cr_assert_not(tileworld_is_cell_alive(tile_world, 1, 0));
+
+    tileworld_arbitrary_kill_cell(tile_world, far, -far);
+    cr_assert_eq(tile_world->population, 2);
+    cr_assert(tileworld_is_cell_alive(tile_world, 0, 0));
+    cr_assert(tileworld_is_cell_alive(tile_world, -1, -1));
+
+    // Empty tiles are freed once they stay empty
+    for (int i = 0; i < 3; i++) {
+        tileworld_next_generation(tile_world);
+    }
+    cr_assert_eq(tile_world->population, 0);
+    cr_assert_eq(tile_world->tile_count, 0);
+
+    tileworld_destroy(&tile_world);
+}
+
+Test(tileworld, glider_crosses_tiles) {
+    TileWorld *tile_world = tileworld_alloc();
+    tileworld_add_glider(tile_world, -3, -3);
+
+    for (int i = 0; i < 4000; i++) {
+        tileworld_next_generation(tile_world);
+        cr_assert_eq(tile_world->population, 5);
+        cr_assert_leq(tile_world->tile_count, 4,
+                      "Generation %d: %zu tiles for a single glider", i,
+                      tile_world->tile_count);
+    }
+
+    // A glider moves one cell diagonally every 4 generations
+    int64_t x = -3 + 1000, y = -3 + 1000;
+    cr_assert(tileworld_is_cell_alive(tile_world, x + 1, y));
+    cr_assert(tileworld_is_cell_alive(tile_world, x + 2, y + 1));
+    cr_assert(tileworld_is_cell_alive(tile_world, x, y + 2));
+    cr_assert(tileworld_is_cell_alive(tile_world, x + 1, y + 2));
+    cr_assert(tileworld_is_cell_alive(tile_world, x + 2, y + 2));
+
+    tileworld_destroy(&tile_world);
+}
+
+Test(tileworld, matches_golstate) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    TileWorld *tile_world = tileworld_alloc();
+
+    // Random soup far from the grid limits
+    int first = GRID_WIDTH / 2 - 100;
+    for (int y = first; y < first + 200; y++) {
+        for (int x = first; x < first + 200; x++) {
+            if (rand() % 3 == 0)
+                golstate_arbitrary_give_birth_cell(gol_state,
+                                                   y * GRID_WIDTH + x);
+        }
+    }
+    cr_assert(tileworld_load_golstate(tile_world, gol_state));
+    cr_assert_eq(tile_world->population, gol_state->population);
+
+    for (int i = 0; i < 100; i++) {
+        golstate_analyze_generation(gol_state);
+        golstate_next_generation(gol_state);
+        tileworld_next_generation(tile_world);
+        cr_assert_eq(tile_world->population, gol_state->population,
+                     "Generation %d: population %ld, expected %d", i,
+                     (long)tile_world->population, gol_state->population);
+    }
+    for (int y = first - 100; y < first + 300; y++) {
+        for (int x = first - 100; x < first + 300; x++) {
+            cr_assert_eq(tileworld_is_cell_alive(tile_world, x, y),
+                         golstate_is_cell_alive(gol_state,
+                                                y * GRID_WIDTH + x),
+                         "Cell (%d, %d) differs from GolState", x, y);
+        }
+    }
+
+    golstate_destroy(&gol_state);
+    tileworld_destroy(&tile_world);
+}
+
+Test(tileworld, rejects_other_golstates) {
+    GolState *gol_state = golstate_alloc(GRID_WIDTH, GRID_WIDTH);
+    TileWorld *tile_world = tileworld_alloc();
+    golstate_arbitrary_give_birth_cell(gol_state, 0);
+
+    LifeRule rule;
+    cr_assert(liferule_parse("B36/S23", &rule));
+    golstate_set_rule(gol_state, rule);
+    cr_assert_not(tileworld_load_golstate(tile_world, gol_state));
+    golstate_set_rule(gol_state, liferule_conway());
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_TORUS);
+    cr_assert_not(tileworld_load_golstate(tile_world, gol_state));
+    golstate_set_topology(gol_state, GOLSTATE_TOPOLOGY_BOUNDED);
+    cr_assert(tileworld_load_golstate(tile_world, gol_state));
+    cr_assert_eq(tile_world->population, 1);
+
+    golstate_destroy(&gol_state);
+    tileworld_destroy(&tile_world);
+}
+
+Test(tileworld, skips_settled_tiles) {
+    TileWorld *tile_world = tileworld_alloc();
+
+    // A block and a blinker in tiles far apart, and a glider in between
+    int64_t block = 10 * TILE_SIZE, blinker = -10 * TILE_SIZE;
+    tileworld_arbitrary_give_birth_cell(tile_world, block, block);
+    tileworld_arbitrary_give_birth_cell(tile_world, block + 1, block);
+    tileworld_arbitrary_give_birth_cell(tile_world, block, block + 1);
+    tileworld_arbitrary_give_birth_cell(tile_world, block + 1, block + 1);
+    for (int i = 0; i < 3; i++) {
+        tileworld_arbitrary_give_birth_cell(tile_world, blinker + i, blinker);
+    }
+    tileworld_arbitrary_give_birth_cell(tile_world, 1, 0);
+    tileworld_arbitrary_give_birth_cell(tile_world, 2, 1);
+    tileworld_arbitrary_give_birth_cell(tile_world, 0, 2);
+    tileworld_arbitrary_give_birth_cell(tile_world, 1, 2);
+    tileworld_arbitrary_give_birth_cell(tile_world, 2, 2);
+
+    for (int i = 0; i < 100; i++) {
+        tileworld_next_generation(tile_world);
+        cr_assert_eq(tile_world->population, 4 + 3 + 5);
+    }
+    cr_assert_geq(tile_world->skipped_tiles, 2,
+                  "Only %zu tiles skipped", tile_world->skipped_tiles);
+    cr_assert_gt(tile_world->total_skipped_tiles, 0);
+
+    // Still and period 2 tiles keep their cells
+    cr_assert(tileworld_is_cell_alive(tile_world, block + 1, block + 1));
+    cr_assert(tileworld_is_cell_alive(tile_world, blinker + 1, blinker));
+    cr_assert(tileworld_is_cell_alive(tile_world, blinker, blinker));
+    tileworld_next_generation(tile_world);
+    cr_assert(tileworld_is_cell_alive(tile_world, blinker + 1, blinker - 1));
+    cr_assert_not(tileworld_is_cell_alive(tile_world, blinker, blinker));
+
+    // Editing a skipped tile brings it back to life
+    tileworld_arbitrary_kill_cell(tile_world, block, block);
+    tileworld_next_generation(tile_world);
+    cr_assert(tileworld_is_cell_alive(tile_world, block, block));
+
+    tileworld_destroy(&tile_world);
+}